@@ -1,67 +1,137 @@
-// hbuf.c - Copyright 2022-25 Andre M. Maree/KSS Technologies (Pty) Ltd.
+// hbuf.c - Copyright 2022-26 Andre M. Maree/KSS Technologies (Pty) Ltd.
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "hal_platform.h"
 #include "hbuf.h"
 
 #include "FreeRTOS_Support.h"
+#include "hal_stdio.h"
 #include "report.h"
 
-// ################################### Global/public functions #####################################
+// ################################### Local/static functions ######################################
 
 /**
- * @brief
+ * @brief	start offset in Buf[] of entry Num, 0 being the oldest
+ */
+static int xHBufStart(hbuf_t * psHB, int Num) {
+	return psHB->Start[(psHB->First + Num) % hbufMAX_CMDS];
+}
+
+/**
+ * @brief	length of entry Num, excluding the terminating '0'
+ */
+static int xHBufLen(hbuf_t * psHB, int Num) {
+	int iEnd = (Num + 1 < psHB->Count) ? xHBufStart(psHB, Num + 1) : psHB->iFree;
+	// end == start only if a single entry fills the ring completely
+	return (iEnd - xHBufStart(psHB, Num) - 1 + cliSIZE_HBUF) % cliSIZE_HBUF;
+}
+
+/**
+ * @brief	number of bytes available for new entries
  */
 static int xHBufAvail(hbuf_t * psHB) {
-	return (psHB->iFree<psHB->iCur) ? (psHB->iCur-psHB->iFree) : (cliSIZE_HBUF-psHB->iFree+psHB->iCur);
+	if (psHB->Count == 0)
+		return cliSIZE_HBUF;
+	int iUsed = ((psHB->iFree - psHB->Start[psHB->First] + cliSIZE_HBUF - 1) % cliSIZE_HBUF) + 1;
+	return cliSIZE_HBUF - iUsed;
 }
 
 /**
- * @brief
+ * @brief	drop oldest entries until Size bytes and an index slot are available
  */
 static void vHBufFree(hbuf_t * psHB, size_t Size) {
-	while (xHBufAvail(psHB) < Size) {
-		while (psHB->Buf[psHB->iNo1]) {
-			++psHB->iNo1;
-			psHB->iNo1 %= cliSIZE_HBUF;
-		}
-		++psHB->iNo1;									// skip over terminating '0'
+	while (psHB->Count && ((xHBufAvail(psHB) < Size) || (psHB->Count == hbufMAX_CMDS))) {
+		psHB->First = (psHB->First + 1) % hbufMAX_CMDS;
 		--psHB->Count;
-		if (psHB->iCur < psHB->iNo1)
-			psHB->iCur = psHB->iNo1;
 	}
+	if (psHB->Count == 0)
+		psHB->iFree = psHB->First = 0;					// empty, restart at the beginning
 }
 
 /**
- * @brief	Add characters from buffer supplied to end of buffer
- * 			If insufficient free space, delete complete entries starting with oldest
+ * @brief	copy Len bytes from the ring starting at iStart, at most 2 segments
  */
-void vHBufAddCmd(hbuf_t * psHB, u8_t * pu8Buf, size_t Size) {
-	if (xHBufAvail(psHB) < Size) {		// insufficient space for current command?
-		vHBufFree(psHB, Size);			// drop oldest command[s]
-	}
-	psHB->iCur = psHB->iFree;			// Save position (of new command 2B added) as current
-	for(int i = 0; i <= Size; ++i) {				// include terminating '0' in copy...
-		psHB->Buf[psHB->iFree++] = pu8Buf[i];
-		psHB->iFree %= cliSIZE_HBUF;
-	}
-	++psHB->Count;
+static void vHBufCopyOut(hbuf_t * psHB, int iStart, u8_t * pu8Buf, size_t Len) {
+	size_t Now = cliSIZE_HBUF - iStart;
+	if (Now > Len)
+		Now = Len;
+	memcpy(pu8Buf, &psHB->Buf[iStart], Now);
+	if (Len > Now)
+		memcpy(pu8Buf + Now, psHB->Buf, Len - Now);
 }
 
 /**
  * @brief	Copy the selected entry from history to buffer supplied
  * @return	number of characters copied
  */
-static int vHBufCopyCmd(hbuf_t * psHB, int iStart, u8_t * pu8Buf, size_t Size) {
-	int iNow = 0;
-	while(iNow < Size) {
-		u8_t U8val = psHB->Buf[iStart + iNow];
-		if (U8val == 0)
-			break;
-		pu8Buf[iNow++] = U8val;
+static int vHBufCopyCmd(hbuf_t * psHB, int Num, u8_t * pu8Buf, size_t Size) {
+	int iLen = xHBufLen(psHB, Num);
+	if (iLen > Size)
+		iLen = Size;
+	vHBufCopyOut(psHB, xHBufStart(psHB, Num), pu8Buf, iLen);
+	return iLen;
+}
+
+/**
+ * @brief	check if entry Num is identical to the Size bytes supplied
+ */
+static bool bHBufSame(hbuf_t * psHB, int Num, u8_t * pu8Buf, size_t Size) {
+	if (xHBufLen(psHB, Num) != Size)
+		return false;
+	int iStart = xHBufStart(psHB, Num);
+	size_t Now = cliSIZE_HBUF - iStart;
+	if (Now > Size)
+		Now = Size;
+	return (memcmp(&psHB->Buf[iStart], pu8Buf, Now) == 0) &&
+			(memcmp(psHB->Buf, pu8Buf + Now, Size - Now) == 0);
+}
+
+/**
+ * @brief	make space for a new entry of Size characters at iFree and record its start
+ * @return	number of characters that fit before the end of Buf[], remainder wraps to the start
+ */
+static size_t xHBufReserve(hbuf_t * psHB, size_t Size) {
+	vHBufFree(psHB, Size + 1);							// drop oldest command[s] if required
+	psHB->Start[(psHB->First + psHB->Count) % hbufMAX_CMDS] = psHB->iFree;
+	size_t Now = cliSIZE_HBUF - psHB->iFree;
+	return (Now > Size) ? Size : Now;
+}
+
+/**
+ * @brief	terminate and count the entry of Size characters stored at iFree
+ */
+static void vHBufCommit(hbuf_t * psHB, size_t Size) {
+	psHB->iFree = (psHB->iFree + Size) % cliSIZE_HBUF;
+	psHB->Buf[psHB->iFree] = 0;							// terminate, source need not be
+	psHB->iFree = (psHB->iFree + 1) % cliSIZE_HBUF;
+	psHB->Sel = ++psHB->Count;							// and back to the fresh line
+	++psHB->Gen;
+}
+
+// ################################### Global/public functions #####################################
+
+void vHBufSetDedup(hbuf_t * psHB, bool bDedup) { psHB->f_dedup = bDedup; }
+
+/**
+ * @brief	Add characters from buffer supplied to end of buffer
+ * 			If insufficient free space, delete complete entries starting with oldest
+ */
+void vHBufAddCmd(hbuf_t * psHB, u8_t * pu8Buf, size_t Size) {
+	if (Size > (cliSIZE_HBUF - 1))
+		Size = cliSIZE_HBUF - 1;						// must fit, with terminator, on its own
+	if (psHB->f_dedup && psHB->Count && bHBufSame(psHB, psHB->Count - 1, pu8Buf, Size)) {
+		psHB->Sel = psHB->Count;						// same as newest, just back to fresh line
+		return;
 	}
-	return iNow;
+	size_t Now = xHBufReserve(psHB, Size);
+	memcpy(&psHB->Buf[psHB->iFree], pu8Buf, Now);
+	memcpy(psHB->Buf, pu8Buf + Now, Size - Now);
+	vHBufCommit(psHB, Size);
 }
 
 // ########################### Commands to support looping through history #########################
@@ -69,46 +139,240 @@ static int vHBufCopyCmd(hbuf_t * psHB, int iStart, u8_t * pu8Buf, size_t Size) {
 /**
  * @brief	copy previous (older) command added to buffer supplied
  * @return	number of characters copied
+ * @note	stops at (and keeps returning) the oldest entry
  */
 int vHBufPrvCmd(hbuf_t * psHB, u8_t * pu8Buf, size_t Size) {
-	if (psHB->Count == 1) {
-		return vHBufCopyCmd(psHB, psHB->iNo1, pu8Buf, Size);
-	}
-	int iNow = (psHB->iCur == 0) ? (psHB->iFree - 1) : (psHB->iCur - 1);
-	do {
-		--iNow;
-		if (iNow >= 0) {
-			if (psHB->Buf[iNow] == 0) {
-				psHB->iCur = ++iNow % cliSIZE_HBUF;
-				return vHBufCopyCmd(psHB, psHB->iCur, pu8Buf, Size);
-			} else {
-				// not yet at terminating '0' NOR start of buffer, hence continue
-			}
-		} else {
-			iNow = cliSIZE_HBUF;							// continue at the end...
-		}
-	} while(1);
+	if (psHB->Count == 0)
+		return 0;
+	if (psHB->Sel > 0)
+		--psHB->Sel;
+	return vHBufCopyCmd(psHB, psHB->Sel, pu8Buf, Size);
 }
 
 /**
  * @brief	copy next (newer) command to buffer supplied
- * @return	number of characters copied
+ * @return	number of characters copied, 0 once stepped past the newest onto the fresh line
  */
 int vHBufNxtCmd(hbuf_t * psHB, u8_t * pu8Buf, size_t Size) {
-	if (psHB->Count == 1) {
-		return vHBufCopyCmd(psHB, psHB->iNo1, pu8Buf, Size);
+	if (psHB->Sel >= psHB->Count)
+		return 0;										// on the fresh line, nothing newer
+	if (++psHB->Sel == psHB->Count)
+		return 0;
+	return vHBufCopyCmd(psHB, psHB->Sel, pu8Buf, Size);
+}
+
+// ############################ Incremental search and prefix completion ###########################
+
+/**
+ * @brief	character at offset Off in the entry starting at iStart
+ */
+static u8_t cHBufChar(hbuf_t * psHB, int iStart, int Off) {
+	return psHB->Buf[(iStart + Off) % cliSIZE_HBUF];
+}
+
+/**
+ * @brief	find first occurrence of the Len character query in entry Num at or after offset iFrom
+ * @return	offset of match or erFAILURE
+ */
+static int xHBufSrchFind(hbuf_t * psHB, hbuf_srch_t * psS, int Num, int iFrom, int Len) {
+	int iStart = xHBufStart(psHB, Num);
+	int iLast = xHBufLen(psHB, Num) - Len;
+	for (int iOff = iFrom; iOff <= iLast; ++iOff) {
+		int i = 0;
+		while (i < Len && cHBufChar(psHB, iStart, iOff + i) == psS->Query[i])
+			++i;
+		if (i == Len)
+			return iOff;
+	}
+	return erFAILURE;
+}
+
+/**
+ * @brief	build Mask[Len] from Mask[Len-1], testing only the previous candidates
+ * @note	prefix mode checks a single character per candidate, substring mode first tries to
+ * 			extend the earlier match in place and only rescans the entry if that fails
+ */
+static void vHBufSrchRefine(hbuf_t * psHB, hbuf_srch_t * psS) {
+	int Len = psS->Len;
+	u32_t Mask = 0;
+	u8_t cChr = psS->Query[Len - 1];
+	for (int Num = 0; Num < psHB->Count; ++Num) {
+		int Slot = (psHB->First + Num) % hbufMAX_CMDS;
+		if ((psS->Mask[Len - 1] & (1UL << Slot)) == 0)
+			continue;
+		int iOff = psS->f_prefix ? 0 : psS->Pos[Slot];
+		if (iOff + Len > xHBufLen(psHB, Num))
+			continue;									// too short, can never match again
+		if (cHBufChar(psHB, xHBufStart(psHB, Num), iOff + Len - 1) != cChr) {
+			if (psS->f_prefix)
+				continue;
+			iOff = xHBufSrchFind(psHB, psS, Num, iOff + 1, Len);
+			if (iOff == erFAILURE)
+				continue;
+			psS->Pos[Slot] = iOff;
+		}
+		Mask |= (1UL << Slot);
+	}
+	psS->Mask[Len] = Mask;
+}
+
+/**
+ * @brief	select newest candidate at or older than entry iFrom and copy it out
+ */
+static int xHBufSrchPick(hbuf_t * psHB, hbuf_srch_t * psS, int iFrom, u8_t * pu8Buf, size_t Size) {
+	if (iFrom >= psHB->Count)
+		iFrom = psHB->Count - 1;
+	for (int Num = iFrom; Num >= 0; --Num) {
+		if (psS->Mask[psS->Len] & (1UL << ((psHB->First + Num) % hbufMAX_CMDS))) {
+			psS->Hit = psHB->Sel = Num;					// cursor keys continue from the match
+			return vHBufCopyCmd(psHB, Num, pu8Buf, Size);
+		}
 	}
-	int iNow = (psHB->iCur == psHB->iFree) ? psHB->iNo1 : psHB->iCur;
-	do {
-		if (psHB->Buf[iNow] == 0) {
-			psHB->iCur = ++iNow % cliSIZE_HBUF;
-			return vHBufCopyCmd(psHB, psHB->iCur, pu8Buf, Size);
+	return erFAILURE;
+}
+
+/**
+ * @brief	(re)build all candidate sets for the current query from scratch
+ */
+static void vHBufSrchBuild(hbuf_t * psHB, hbuf_srch_t * psS) {
+	u32_t Mask = 0;
+	for (int Num = 0; Num < psHB->Count; ++Num)
+		Mask |= (1UL << ((psHB->First + Num) % hbufMAX_CMDS));
+	psS->Mask[0] = Mask;
+	memset(psS->Pos, 0, sizeof(psS->Pos));
+	int Len = psS->Len;
+	for (psS->Len = 1; psS->Len <= Len; ++psS->Len)
+		vHBufSrchRefine(psHB, psS);
+	psS->Len = Len;
+	psS->Gen = psHB->Gen;
+}
+
+/**
+ * @brief	history changed (command added) since the candidates were built ?
+ */
+static void vHBufSrchCheck(hbuf_t * psHB, hbuf_srch_t * psS) {
+	if (psS->Gen != psHB->Gen) {
+		vHBufSrchBuild(psHB, psS);
+		psS->Hit = psHB->Count;
+	}
+}
+
+int xHBufSrchStart(hbuf_t * psHB, hbuf_srch_t * psS, bool bPrefix, const u8_t * pu8Query, size_t Len, u8_t * pu8Buf, size_t Size) {
+	if (Len > hbufSRCH_MAX)
+		Len = hbufSRCH_MAX;
+	if (Len)
+		memcpy(psS->Query, pu8Query, Len);
+	psS->Len = Len;
+	psS->f_prefix = bPrefix;
+	vHBufSrchBuild(psHB, psS);
+	psS->Hit = psHB->Count;
+	return Len ? xHBufSrchPick(psHB, psS, psS->Hit, pu8Buf, Size) : 0;
+}
+
+int xHBufSrchAdd(hbuf_t * psHB, hbuf_srch_t * psS, u8_t cChr, u8_t * pu8Buf, size_t Size) {
+	vHBufSrchCheck(psHB, psS);
+	if (psS->Len == hbufSRCH_MAX)
+		return erFAILURE;
+	psS->Query[psS->Len++] = cChr;
+	vHBufSrchRefine(psHB, psS);
+	return xHBufSrchPick(psHB, psS, psS->Hit, pu8Buf, Size);
+}
+
+int xHBufSrchDel(hbuf_t * psHB, hbuf_srch_t * psS, u8_t * pu8Buf, size_t Size) {
+	vHBufSrchCheck(psHB, psS);
+	if (psS->Len == 0)
+		return 0;
+	--psS->Len;
+	if (!psS->f_prefix) {								// first match offsets of shorter query
+		for (int Num = 0; Num < psHB->Count; ++Num) {
+			int Slot = (psHB->First + Num) % hbufMAX_CMDS;
+			if (psS->Mask[psS->Len] & (1UL << Slot))
+				psS->Pos[Slot] = xHBufSrchFind(psHB, psS, Num, 0, psS->Len);
 		}
-		++iNow;
-		iNow %= cliSIZE_HBUF;
-	} while(1);
+	}
+	return psS->Len ? xHBufSrchPick(psHB, psS, psS->Hit, pu8Buf, Size) : 0;
+}
+
+int xHBufSrchNxt(hbuf_t * psHB, hbuf_srch_t * psS, u8_t * pu8Buf, size_t Size) {
+	vHBufSrchCheck(psHB, psS);
+	if (psS->Hit == 0)
+		return erFAILURE;
+	return xHBufSrchPick(psHB, psS, psS->Hit - 1, pu8Buf, Size);
 }
 
+// ##################################### Persistent history ########################################
+
+/**
+ * @brief	read a record body of Size characters straight into the ring
+ * @return	erSUCCESS or erFAILURE if the record is invalid or incomplete
+ */
+static int xHBufReadCmd(void * pvHist, int fd, size_t Size) {
+	hbuf_t * psHB = pvHist;
+	if (Size > (cliSIZE_HBUF - 1))
+		return erFAILURE;
+	size_t Now = xHBufReserve(psHB, Size);
+	if ((read(fd, &psHB->Buf[psHB->iFree], Now) != Now) ||
+		(Size > Now && read(fd, psHB->Buf, Size - Now) != (Size - Now)))
+		return erFAILURE;
+	vHBufCommit(psHB, Size);
+	return erSUCCESS;
+}
+
+/**
+ * @brief	check that a loaded image is consistent, else start with an empty history
+ */
+static void vHBufCheck(hbuf_t * psHB) {
+	if ((psHB->iFree < cliSIZE_HBUF) && (psHB->First < hbufMAX_CMDS) && (psHB->Count <= hbufMAX_CMDS)) {
+		int Num = 0;
+		while ((Num < psHB->Count) && (xHBufStart(psHB, Num) < cliSIZE_HBUF))
+			++Num;
+		if (Num == psHB->Count)
+			return;
+	}
+	psHB->iFree = psHB->First = psHB->Count = 0;
+}
+
+/**
+ * @brief	read the snapshot image straight into the history
+ */
+static int xHBufLoadImage(void * pvHist, int fd) {
+	hbuf_t * psHB = pvHist;
+	u8_t f_dedup = psHB->f_dedup;						// runtime setting, not history
+	int iRV = (read(fd, psHB, sizeof(hbuf_t)) == sizeof(hbuf_t)) ? erSUCCESS : erFAILURE;
+	if (iRV == erSUCCESS)
+		vHBufCheck(psHB);
+	else
+		memset(psHB, 0, sizeof(hbuf_t));
+	psHB->f_dedup = f_dedup;
+	return iRV;
+}
+
+static int xHBufSaveImage(void * pvHist, int fd) {
+	return (write(fd, pvHist, sizeof(hbuf_t)) == sizeof(hbuf_t)) ? erSUCCESS : erFAILURE;
+}
+
+static const hlog_ops_t sHBufLogOps = {
+	.Magic = hbufLOG_MAGIC, .save = xHBufSaveImage, .load = xHBufLoadImage, .replay = xHBufReadCmd,
+};
+
+int xHBufLogCompact(hbuf_t * psHB, hbuf_log_t * psL) { return xHLogCompact(psL); }
+
+int xHBufLogOpen(hbuf_t * psHB, hbuf_log_t * psL, const char * pccPath) {
+	int iRV = xHLogOpen(psL, &sHBufLogOps, psHB, sizeof(hbuf_t), hbufLOG_COMPACT, pccPath);
+	psHB->Sel = psHB->Count;							// on the fresh line, not browsing
+	return iRV;
+}
+
+int xHBufLogAdd(hbuf_t * psHB, hbuf_log_t * psL, u8_t * pu8Buf, size_t Size) {
+	u8_t Gen = psHB->Gen;
+	vHBufAddCmd(psHB, pu8Buf, Size);
+	if (Gen == psHB->Gen)
+		return erSUCCESS;								// duplicate suppressed, nothing to log
+	return xHLogAppend(psL, pu8Buf, (Size > (cliSIZE_HBUF - 1)) ? (cliSIZE_HBUF - 1) : Size);
+}
+
+void vHBufLogClose(hbuf_log_t * psL) { vHLogClose(psL); }
+
 /**
  * @brief
  * @param   psR pointer to report control structure (NULL allowed)
@@ -117,26 +381,16 @@ int vHBufNxtCmd(hbuf_t * psHB, u8_t * pu8Buf, size_t Size) {
 */
 int xHBufReport(report_t * psR, hbuf_t * psHB) {
 	int iRV = 0;
-	if (psHB->Count == 0) {
-		iRV += xReport(psR, "# HBuf #: No1=%d  Cur=%d  Free=%d  Cnt=%d", psHB->iNo1, psHB->iCur, psHB->iFree, psHB->Count);
-		u8_t * pNow = &psHB->Buf[psHB->iNo1];
-		u8_t u8Len;
-		while (true) {
-			u8Len = 0;
-			while (*pNow) {
-				if (u8Len == 0)
-					iRV += xReport(psR, " '");
-				iRV += xReport(psR, "%c", *pNow);
-				++pNow;
-				if (pNow == &psHB->Buf[cliSIZE_HBUF])
-					pNow = psHB->Buf;
-				++u8Len;
+	if (psHB->Count) {
+		iRV += xReport(psR, "# HBuf #: No1=%d  Sel=%d  Free=%d  Cnt=%d", psHB->Start[psHB->First], psHB->Sel, psHB->iFree, psHB->Count);
+		for (int Num = 0; Num < psHB->Count; ++Num) {
+			int iNow = xHBufStart(psHB, Num);
+			iRV += xReport(psR, " '");
+			for (int iLen = xHBufLen(psHB, Num); iLen; --iLen) {
+				iRV += xReport(psR, "%c", psHB->Buf[iNow]);
+				iNow = (iNow + 1) % cliSIZE_HBUF;
 			}
-			if (u8Len > 0)
-				iRV += xReport(psR, "'");
-			++pNow;											// step over terminating '0'
-			if (pNow == &psHB->Buf[psHB->iFree])
-				break;
+			iRV += xReport(psR, "'");
 		}
 	} else {
 		iRV += xReport(psR, "CLI buffer empty");
@@ -144,3 +398,82 @@ int xHBufReport(report_t * psR, hbuf_t * psHB) {
 	xReport(psR, fmTST(aNL) ? strNLx2 : strNL);
 	return iRV;
 }
+
+// ################################## Diagnostic and testing functions #############################
+
+#ifndef	hbufTEST_LOG
+	#define	hbufTEST_LOG		"/spiffs/hbuf.log"		// any mounted VFS path, override in build config
+#endif
+
+static hbuf_t sHBufTest;
+
+static bool bHBufTestIs(int iRV, u8_t * pu8Buf, const char * pccExp) {
+	return (iRV == strlen(pccExp)) && (memcmp(pu8Buf, pccExp, iRV) == 0);
+}
+
+void vHBufTest(void) {
+	hbuf_t * psHB = &sHBufTest;
+	u8_t caBuf[48];
+	// navigation stops at either end, no wrap
+	memset(psHB, 0, sizeof(hbuf_t));
+	vHBufAddCmd(psHB, (u8_t *) "one", 3);
+	vHBufAddCmd(psHB, (u8_t *) "two", 3);
+	vHBufAddCmd(psHB, (u8_t *) "three", 5);
+	if (!bHBufTestIs(vHBufPrvCmd(psHB, caBuf, sizeof(caBuf)), caBuf, "three"))	PX("Failed prv" strNL);
+	vHBufPrvCmd(psHB, caBuf, sizeof(caBuf));
+	vHBufPrvCmd(psHB, caBuf, sizeof(caBuf));
+	if (!bHBufTestIs(vHBufPrvCmd(psHB, caBuf, sizeof(caBuf)), caBuf, "one"))	PX("Failed oldest" strNL);
+	if (!bHBufTestIs(vHBufNxtCmd(psHB, caBuf, sizeof(caBuf)), caBuf, "two"))	PX("Failed nxt" strNL);
+	vHBufNxtCmd(psHB, caBuf, sizeof(caBuf));
+	if (vHBufNxtCmd(psHB, caBuf, sizeof(caBuf)) || vHBufNxtCmd(psHB, caBuf, sizeof(caBuf)))	PX("Failed fresh" strNL);
+	// oldest evicted once the index is full
+	for (int i = 0; i < hbufMAX_CMDS + 2; ++i) {
+		int Len = snprintf((char *) caBuf, sizeof(caBuf), "cmd%d", i);
+		vHBufAddCmd(psHB, caBuf, Len);
+	}
+	if ((psHB->Count != hbufMAX_CMDS) || (psHB->Sel != psHB->Count))			PX("Failed count" strNL);
+	for (int i = 0; i < hbufMAX_CMDS; ++i)
+		vHBufPrvCmd(psHB, caBuf, sizeof(caBuf));
+	if (!bHBufTestIs(vHBufPrvCmd(psHB, caBuf, sizeof(caBuf)), caBuf, "cmd2"))	PX("Failed evict" strNL);
+
+	// incremental search: refine, older match, backspace, prefix completion
+	hbuf_srch_t sS;
+	memset(psHB, 0, sizeof(hbuf_t));
+	vHBufAddCmd(psHB, (u8_t *) "wifi scan", 9);
+	vHBufAddCmd(psHB, (u8_t *) "reboot", 6);
+	vHBufAddCmd(psHB, (u8_t *) "show wifi", 9);
+	int iRV = xHBufSrchStart(psHB, &sS, false, (u8_t *) "wi", 2, caBuf, sizeof(caBuf));
+	if (!bHBufTestIs(iRV, caBuf, "show wifi"))									PX("Failed search" strNL);
+	if (!bHBufTestIs(xHBufSrchNxt(psHB, &sS, caBuf, sizeof(caBuf)), caBuf, "wifi scan"))	PX("Failed older" strNL);
+	if (xHBufSrchAdd(psHB, &sS, 'x', caBuf, sizeof(caBuf)) != erFAILURE)		PX("Failed refine" strNL);
+	if (!bHBufTestIs(xHBufSrchDel(psHB, &sS, caBuf, sizeof(caBuf)), caBuf, "wifi scan"))	PX("Failed del" strNL);
+	iRV = xHBufSrchStart(psHB, &sS, true, (u8_t *) "re", 2, caBuf, sizeof(caBuf));
+	if (!bHBufTestIs(iRV, caBuf, "reboot"))										PX("Failed prefix" strNL);
+	if (xHBufSrchStart(psHB, &sS, true, (u8_t *) "fi", 2, caBuf, sizeof(caBuf)) != erFAILURE)	PX("Failed no prefix" strNL);
+	// an add during a search is picked up
+	xHBufSrchStart(psHB, &sS, false, (u8_t *) "re", 2, caBuf, sizeof(caBuf));
+	vHBufAddCmd(psHB, (u8_t *) "reset", 5);
+	if (!bHBufTestIs(xHBufSrchNxt(psHB, &sS, caBuf, sizeof(caBuf)), caBuf, "reset"))	PX("Failed changed" strNL);
+
+	// persistent log: appended, reloaded, compacted
+	hbuf_log_t sL;
+	memset(psHB, 0, sizeof(hbuf_t));
+	unlink(hbufTEST_LOG);
+	if (xHBufLogOpen(psHB, &sL, hbufTEST_LOG) == erFAILURE) {
+		PX("log SKIPPED, no file system at " hbufTEST_LOG strNL);
+		return;
+	}
+	xHBufLogAdd(psHB, &sL, (u8_t *) "first", 5);
+	xHBufLogAdd(psHB, &sL, (u8_t *) "second", 6);
+	if (sL.Appended != (2 * sizeof(u16_t) + 11))								PX("Failed append" strNL);
+	vHBufLogClose(&sL);
+	memset(psHB, 0, sizeof(hbuf_t));
+	if ((xHBufLogOpen(psHB, &sL, hbufTEST_LOG) != erSUCCESS) || (psHB->Count != 2))	PX("Failed load" strNL);
+	if (!bHBufTestIs(vHBufPrvCmd(psHB, caBuf, sizeof(caBuf)), caBuf, "second"))	PX("Failed replay" strNL);
+	if ((xHBufLogCompact(psHB, &sL) != erSUCCESS) || sL.Appended)				PX("Failed compact" strNL);
+	vHBufLogClose(&sL);
+	memset(psHB, 0, sizeof(hbuf_t));
+	if ((xHBufLogOpen(psHB, &sL, hbufTEST_LOG) != erSUCCESS) || (psHB->Count != 2))	PX("Failed reload" strNL);
+	vHBufLogClose(&sL);
+	unlink(hbufTEST_LOG);
+}
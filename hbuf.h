@@ -3,6 +3,7 @@
 #pragma	once
 
 #include "definitions.h"
+#include "x_hlog.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -11,25 +12,143 @@ extern "C" {
 // ##################################### MACRO definitions #########################################
 
 #define cliSIZE_HBUF	1024
+#define	hbufMAX_CMDS	32				// entries indexed, oldest evicted once reached
+#define	hbufSRCH_MAX	32				// maximum search/completion query length
+#define	hbufLOG_MAGIC	0x46554248		// "HBUF"
+
+// ###################################### BUILD : CONFIG definitions ###############################
+
+#ifndef hbufLOG_COMPACT
+	#define	hbufLOG_COMPACT	(cliSIZE_HBUF * 2)	// appended record bytes that trigger compaction
+#endif
 
 // ####################################### enumerations ############################################
 
 // ####################################### structures  #############################################
 
+/* Commands are stored back to back, NUL terminated, in the Buf[] ring. Start[] is a second ring
+ * holding the offset of each command, oldest at Start[First], hence navigation and eviction are
+ * index moves and never scan the text. Sel is the entry displayed, Sel == Count is the fresh line.
+ * An all zero structure is a valid empty history.
+ * NOTE: replaces the earlier iNo1/iCur/iFree/Count (all u16_t) layout, code or images depending
+ * on that layout must be rebuilt, a persisted image of it is rejected by the log Size check. */
 typedef struct __attribute__((packed)) {
-	u16_t iNo1;						// index to start of 1st saved command
-	u16_t iCur;						// index to start of selected command in buffer
 	u16_t iFree;					// index to 1st free location in buffer
-	u16_t Count;					// number of commands in buffer
+	u16_t Start[hbufMAX_CMDS];		// ring of entry start offsets
+	u8_t First;						// Start[] slot of the oldest entry
+	u8_t Count;						// number of commands in buffer
+	u8_t Sel;						// entry selected, 0 = oldest, Count = fresh line
+	u8_t Gen;						// bumped by every add, iFree/First/Count can all repeat
+	u8_t f_dedup:1;					// do not add a command identical to the newest
+	u8_t f_spare:7;
 	u8_t Buf[cliSIZE_HBUF];
 } hbuf_t;
 
+/* Incremental search state. Mask[n] is the set of Start[] slots matching the first n characters
+ * of the query, so each keystroke only tests the previous candidates and backspace is a pop. */
+typedef struct {
+	u32_t Mask[hbufSRCH_MAX + 1];	// candidate slots, by query length
+	u16_t Pos[hbufMAX_CMDS];		// offset of first match in each candidate (substring mode)
+	u8_t Gen;						// history generation the candidates were built from
+	u8_t Query[hbufSRCH_MAX];
+	u8_t Len;						// current query length
+	u8_t Hit;						// entry number of current match, Count = none yet
+	u8_t f_prefix:1;				// match at the start of entries only (completion)
+	u8_t f_spare:7;
+} hbuf_srch_t;
+
+DUMB_STATIC_ASSERT(hbufMAX_CMDS <= 32);		// candidate sets are u32_t masks of Start[] slots
+
+/* History log file, see x_hlog.h: the image is the hbuf_t itself and each record a command,
+ * read straight into Buf[]. */
+typedef hlog_t hbuf_log_t;
+
 // ################################### EXTERNAL FUNCTIONS ##########################################
 
+/**
+ * @brief		enable/disable suppression of consecutive duplicate commands
+ * @param[in]	psHB - pointer to history buffer
+ * @param[in]	bDedup - true to suppress a command identical to the newest entry
+ */
+void vHBufSetDedup(hbuf_t * psHB, bool bDedup);
+
 void vHBufAddCmd(hbuf_t *, u8_t *, size_t);
+
+/**
+ * @brief		step to the next (newer) command and copy it out
+ * @return		number of characters copied, 0 once stepped past the newest onto the fresh line
+ * @note		does not wrap to the oldest entry as the earlier layout did, stays on the fresh line
+ */
 int vHBufNxtCmd(hbuf_t *, u8_t *, size_t);
+
+/**
+ * @brief		step to the previous (older) command and copy it out
+ * @return		number of characters copied, 0 if the history is empty
+ * @note		does not wrap to the newest entry as the earlier layout did, stops at (and keeps
+ * 				returning) the oldest entry
+ */
 int vHBufPrvCmd(hbuf_t *, u8_t *, size_t);
 
+/**
+ * @brief		start an incremental (Ctrl-R style) search or prefix completion
+ * @param[in]	psHB - pointer to history buffer
+ * @param[in]	psS - pointer to search state, owned by the caller for the duration of the search
+ * @param[in]	bPrefix - true to match entries starting with the query, false for anywhere
+ * @param[in]	pu8Query - initial query, can be NULL if Len is 0
+ * @param[in]	Len - initial query length
+ * @param[out]	pu8Buf - buffer to receive the newest matching entry
+ * @param[in]	Size - size of buffer
+ * @return		number of characters copied, 0 if query empty, erFAILURE if no match
+ */
+int xHBufSrchStart(hbuf_t * psHB, hbuf_srch_t * psS, bool bPrefix, const u8_t * pu8Query, size_t Len, u8_t * pu8Buf, size_t Size);
+
+/**
+ * @brief		extend the query by one character, refining the current candidates
+ * @return		number of characters copied, erFAILURE if no (older or same) entry matches
+ */
+int xHBufSrchAdd(hbuf_t * psHB, hbuf_srch_t * psS, u8_t cChr, u8_t * pu8Buf, size_t Size);
+
+/**
+ * @brief		remove the last query character, restoring the previous candidates
+ * @return		number of characters copied, erFAILURE if no match
+ */
+int xHBufSrchDel(hbuf_t * psHB, hbuf_srch_t * psS, u8_t * pu8Buf, size_t Size);
+
+/**
+ * @brief		step to the next older entry matching the current query (Ctrl-R/Tab again)
+ * @return		number of characters copied, erFAILURE if no older match
+ */
+int xHBufSrchNxt(hbuf_t * psHB, hbuf_srch_t * psS, u8_t * pu8Buf, size_t Size);
+
+/**
+ * @brief		load history from a log file, creating it if absent or invalid, and keep it open
+ * @param[in]	psHB - pointer to history buffer, current contents replaced if log loaded
+ * @param[in]	psL - pointer to log control structure
+ * @param[in]	pccPath - log file path, shorter than hlogPATHMAX - 1
+ * @return		erSUCCESS or erFAILURE with errno set
+ * @note		a record cut short (power lost during append) is discarded and the log compacted
+ */
+int xHBufLogOpen(hbuf_t * psHB, hbuf_log_t * psL, const char * pccPath);
+
+/**
+ * @brief		add a command to the history and append it to the log
+ * @return		erSUCCESS or erFAILURE with errno set, history updated regardless
+ * @note		compacts the log once hbufLOG_COMPACT record bytes have been appended, or if the log
+ * 				is not open because an earlier compaction failed
+ */
+int xHBufLogAdd(hbuf_t * psHB, hbuf_log_t * psL, u8_t * pu8Buf, size_t Size);
+
+/**
+ * @brief		rewrite the log as a single snapshot of the current history
+ * @return		erSUCCESS or erFAILURE with errno set
+ * @note		written to "path~" then renamed over the log. Where the file system does not rename
+ * 				over, the log is removed first and a later xHBufLogOpen() recovers "path~".
+ * @note		on failure the existing log, if any, is reopened for append
+ */
+int xHBufLogCompact(hbuf_t * psHB, hbuf_log_t * psL);
+
+void vHBufLogClose(hbuf_log_t * psL);
+
 struct report_t;
 int xHBufReport(struct report_t *, hbuf_t *);
 
@@ -0,0 +1,176 @@
+// x_balloc.c - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+#include "hal_platform.h"
+#include "x_balloc.h"
+
+#include "hal_stdio.h"
+#include "report.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(ESP_PLATFORM)
+	#include "esp_heap_caps.h"
+#endif
+
+#define	debugFLAG					0xF000
+
+#define	debugTIMING					(debugFLAG_GLOBAL & debugFLAG & 0x1000)
+#define	debugTRACK					(debugFLAG_GLOBAL & debugFLAG & 0x2000)
+#define	debugPARAM					(debugFLAG_GLOBAL & debugFLAG & 0x4000)
+#define	debugRESULT					(debugFLAG_GLOBAL & debugFLAG & 0x8000)
+
+// #################################### PRIVATE structures #########################################
+
+static size_t BAllocNow[ballocTYPE_NUMBER];
+static size_t BAllocPeak[ballocTYPE_NUMBER];		// statistics only, updated without lock
+static size_t BAllocTotal;
+static size_t BAllocBudget;							// 0 = unlimited
+static u32_t BAllocRefused;
+static balloc_reclaim_t BAllocReclaim;
+
+static const char * const caBAllocType[ballocTYPE_NUMBER] = { "Other", "buf", "ubuf", "uubuf", "mrbuf", "plbuf" };
+
+// ################################# Local/static functions ########################################
+
+/**
+ * @brief		add Size to the total if within the budget, lock free
+ * @return		true if charged
+ */
+static bool bBAllocCharge(size_t Size) {
+	size_t Now = __atomic_load_n(&BAllocTotal, __ATOMIC_RELAXED);
+	do {
+		if (BAllocBudget && ((Now + Size) > BAllocBudget))
+			return false;
+	} while (!__atomic_compare_exchange_n(&BAllocTotal, &Now, Now + Size, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	return true;
+}
+
+#if defined(ESP_PLATFORM)
+
+static void * pvBAllocHeapCaps(size_t Size, u32_t Caps) {
+	u32_t HeapCaps = MALLOC_CAP_8BIT;
+	if (Caps & ballocCAP_INTERNAL)
+		HeapCaps |= MALLOC_CAP_INTERNAL;
+	if (Caps & ballocCAP_SPIRAM)
+		HeapCaps |= MALLOC_CAP_SPIRAM;
+	if (Caps & ballocCAP_DMA)
+		HeapCaps |= MALLOC_CAP_DMA;
+	size_t Align = ballocGET_ALIGN(Caps);
+	return Align ? heap_caps_aligned_alloc(Align, Size, HeapCaps) : heap_caps_malloc(Size, HeapCaps);
+}
+
+const balloc_t sBAllocDefault = { .pvAlloc = pvBAllocHeapCaps, .vFree = heap_caps_free };
+
+#else
+
+static void * pvBAllocHost(size_t Size, u32_t Caps) {		// capabilities are meaningless on a host
+	size_t Align = ballocGET_ALIGN(Caps);
+	if (Align == 0)
+		return malloc(Size);
+	void * pv;
+	if (Align < sizeof(void *))
+		Align = sizeof(void *);							// posix_memalign() minimum
+	return posix_memalign(&pv, Align, Size) ? NULL : pv;
+}
+
+const balloc_t sBAllocDefault = { .pvAlloc = pvBAllocHost, .vFree = free };
+
+#endif
+
+// ################################### Global/public functions #####################################
+
+void * pvBAlloc(const balloc_t * psA, size_t Size, u32_t Caps) {
+	IF_myASSERT(debugPARAM, (ballocGET_ALIGN(Caps) & (ballocGET_ALIGN(Caps) - 1)) == 0);
+	if (psA == NULL)
+		psA = &sBAllocDefault;
+	void * pv = psA->pvAlloc(Size, Caps);
+	if (pv && (Caps & ballocCAP_ZERO))
+		memset(pv, 0, Size);
+	return pv;
+}
+
+void vBFree(const balloc_t * psA, void * pv) {
+	if (pv == NULL)
+		return;
+	if (psA == NULL)
+		psA = &sBAllocDefault;
+	psA->vFree(pv);
+}
+
+void * pvBAllocType(const balloc_t * psA, int Type, size_t Size, u32_t Caps) {
+	IF_myASSERT(debugPARAM, INRANGE(0, Type, ballocTYPE_NUMBER - 1));
+	if (!bBAllocCharge(Size) && ((BAllocReclaim == NULL) || (BAllocReclaim(Size) == 0) || !bBAllocCharge(Size))) {
+		__atomic_fetch_add(&BAllocRefused, 1, __ATOMIC_RELAXED);
+		errno = ENOMEM;
+		return NULL;
+	}
+	void * pv = pvBAlloc(psA, Size, Caps);
+	if (pv == NULL) {
+		__atomic_fetch_sub(&BAllocTotal, Size, __ATOMIC_RELAXED);
+		return NULL;
+	}
+	size_t Now = __atomic_add_fetch(&BAllocNow[Type], Size, __ATOMIC_RELAXED);
+	if (Now > BAllocPeak[Type])
+		BAllocPeak[Type] = Now;
+	return pv;
+}
+
+void vBFreeType(const balloc_t * psA, int Type, void * pv, size_t Size) {
+	if (pv == NULL)
+		return;
+	vBFree(psA, pv);
+	__atomic_fetch_sub(&BAllocNow[Type], Size, __ATOMIC_RELAXED);
+	__atomic_fetch_sub(&BAllocTotal, Size, __ATOMIC_RELAXED);
+}
+
+void vBAllocSetBudget(size_t Budget) { BAllocBudget = Budget; }
+
+void vBAllocSetReclaim(balloc_reclaim_t hook) { BAllocReclaim = hook; }
+
+size_t xBAllocUsed(int Type) {
+	return (Type < 0) ? BAllocTotal : BAllocNow[Type];
+}
+
+int xBAllocReport(report_t * psR) {
+	int iRV = xReport(psR, "Total=%lu  Budget=%lu  Refused=%lu" strNL, BAllocTotal, BAllocBudget, BAllocRefused);
+	for (int i = 0; i < ballocTYPE_NUMBER; ++i) {
+		if (BAllocPeak[i])
+			iRV += xReport(psR, "  %s  Now=%lu  Peak=%lu" strNL, caBAllocType[i], BAllocNow[i], BAllocPeak[i]);
+	}
+	return iRV;
+}
+
+// ################################## Diagnostic and testing functions #############################
+
+static int BAllocTestAllocs, BAllocTestFrees;
+
+static void * pvBAllocTestAlloc(size_t Size, u32_t Caps) {
+	++BAllocTestAllocs;
+	return sBAllocDefault.pvAlloc(Size, Caps);
+}
+
+static void vBAllocTestFree(void * pv) {
+	++BAllocTestFrees;
+	sBAllocDefault.vFree(pv);
+}
+
+void vBAllocTest(void) {
+	const balloc_t sA = { .pvAlloc = pvBAllocTestAlloc, .vFree = vBAllocTestFree };
+	BAllocTestAllocs = BAllocTestFrees = 0;
+	// caller supplied allocator, alignment and clearing honoured
+	u8_t * pu8 = pvBAlloc(&sA, 100, ballocCAP_ZERO | ballocALIGN(64));
+	if ((pu8 == NULL) || (BAllocTestAllocs != 1))								PX("Failed alloc" strNL);
+	if (pu8 && (((uintptr_t) pu8 & 63) || pu8[0] || pu8[99]))					PX("Failed align/zero" strNL);
+	vBFree(&sA, pu8);
+	if (BAllocTestFrees != 1)													PX("Failed free" strNL);
+	// typed allocations accounted per type and in total
+	size_t Type = xBAllocUsed(ballocTYPE_OTHER), Total = xBAllocUsed(-1);
+	pu8 = pvBAllocType(&sA, ballocTYPE_OTHER, 200, ballocCAP_DEFAULT);
+	if ((pu8 == NULL) || (xBAllocUsed(ballocTYPE_OTHER) != Type + 200))			PX("Failed account" strNL);
+	if (xBAllocUsed(-1) != Total + 200)											PX("Failed total" strNL);
+	vBFreeType(&sA, ballocTYPE_OTHER, pu8, 200);
+	if ((xBAllocUsed(ballocTYPE_OTHER) != Type) || (xBAllocUsed(-1) != Total))	PX("Failed release" strNL);
+	if (BAllocTestFrees != 2)													PX("Failed free type" strNL);
+}
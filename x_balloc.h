@@ -0,0 +1,104 @@
+// x_balloc.h - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+#pragma	once
+
+#include "definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ##################################### MACRO definitions #########################################
+
+#define	ballocCAP_DEFAULT			0x00000000		// any byte addressable memory
+#define	ballocCAP_INTERNAL			0x00000001		// internal RAM, eg ISR touched rings
+#define	ballocCAP_SPIRAM			0x00000002		// external PSRAM, bulk/capture rings
+#define	ballocCAP_DMA				0x00000004		// DMA capable, eg UART/SPI paths
+#define	ballocCAP_ZERO				0x00000008		// clear memory after allocation
+#define	ballocCAP_MASK				0x0000FFFF
+
+#define	ballocALIGN(x)				((u32_t)(x) << 16)	// x = alignment in bytes, power of 2
+#define	ballocGET_ALIGN(c)			((c) >> 16)
+
+// ####################################### enumerations ############################################
+
+enum {												// accounting categories, see pvBAllocType()
+	ballocTYPE_OTHER,
+	ballocTYPE_BUF,									// buf_t storage
+	ballocTYPE_UBUF,								// ubuf_t storage, control, flush/spill/zip/dedup, stages
+	ballocTYPE_UUBUF,
+	ballocTYPE_MRBUF,
+	ballocTYPE_PLBUF,
+	ballocTYPE_NUMBER
+};
+
+// ####################################### structures  #############################################
+
+typedef struct balloc_t {
+	void * (*pvAlloc)(size_t Size, u32_t Caps);		// Caps = ballocCAP_??? | ballocALIGN(x)
+	void (*vFree)(void * pv);
+} balloc_t;
+
+// ################################### EXTERNAL FUNCTIONS ##########################################
+
+extern const balloc_t sBAllocDefault;				// heap_caps on ESP-IDF, libc on host
+
+/**
+ * @brief		allocate memory using the allocator and capabilities specified
+ * @param[in]	psA - allocator to use, NULL for sBAllocDefault
+ * @param[in]	Size - number of bytes required
+ * @param[in]	Caps - ballocCAP_??? flags, optionally with ballocALIGN(x)
+ * @return		pointer to memory allocated or NULL if failed
+ */
+void * pvBAlloc(const balloc_t * psA, size_t Size, u32_t Caps);
+
+/**
+ * @brief		free memory allocated with pvBAlloc()
+ * @param[in]	psA - allocator used for the allocation, NULL for sBAllocDefault
+ * @param[in]	pv - pointer to memory to be freed, NULL is ignored
+ */
+void vBFree(const balloc_t * psA, void * pv);
+
+/**
+ * @brief		reclaim hook, release storage that can be reallocated later
+ * @param[in]	Need - number of bytes the refused allocation requires
+ * @return		number of bytes released
+ */
+typedef size_t (* balloc_reclaim_t)(size_t Need);
+
+/**
+ * @brief		allocate buffer storage, accounted per type and against the global budget
+ * @param[in]	Type - ballocTYPE_??? category
+ * @return		pointer to memory or NULL, errno = ENOMEM if refused by the budget
+ * @note		If the budget would be exceeded the reclaim hook (if any) is called once
+ */
+void * pvBAllocType(const balloc_t * psA, int Type, size_t Size, u32_t Caps);
+
+/**
+ * @brief		free memory allocated with pvBAllocType(), Type and Size as allocated
+ */
+void vBFreeType(const balloc_t * psA, int Type, void * pv, size_t Size);
+
+/**
+ * @brief		set the maximum number of bytes of all types together, 0 = unlimited (default)
+ * @note		Lowering it below the current use does not free anything, only refuses new allocations
+ */
+void vBAllocSetBudget(size_t Budget);
+
+/**
+ * @brief		set (or clear with NULL) the hook called when an allocation exceeds the budget
+ * @note		the hook must not allocate with pvBAllocType() and must only try-lock other objects
+ */
+void vBAllocSetReclaim(balloc_reclaim_t hook);
+
+/**
+ * @brief		bytes currently allocated of a type, -1 for all types together
+ */
+size_t xBAllocUsed(int Type);
+
+struct report_t;
+int xBAllocReport(struct report_t * psR);
+
+#ifdef __cplusplus
+}
+#endif
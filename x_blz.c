@@ -0,0 +1,120 @@
+// x_blz.c - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+#include "hal_platform.h"
+#include "x_blz.h"
+
+#include <string.h>
+
+#define	debugFLAG					0xF000
+
+#define	debugTIMING					(debugFLAG_GLOBAL & debugFLAG & 0x1000)
+#define	debugTRACK					(debugFLAG_GLOBAL & debugFLAG & 0x2000)
+#define	debugPARAM					(debugFLAG_GLOBAL & debugFLAG & 0x4000)
+#define	debugRESULT					(debugFLAG_GLOBAL & debugFLAG & 0x8000)
+
+// ##################################### MACRO definitions #########################################
+
+#define	blzMAX_LIT					32			// literal run per control byte
+#define	blzMAX_OFF					8192
+#define	blzMAX_REF					(7 + 255 + 2)	// longest match encoded
+
+// ################################# Local/static functions ########################################
+
+static u32_t xBLzHash(const u8_t * p) {
+	u32_t X = (p[0] << 16) | (p[1] << 8) | p[2];
+	return ((X * 2654435761UL) >> (32 - blzHASH_BITS)) & ((1UL << blzHASH_BITS) - 1);
+}
+
+/**
+ * @brief		emit literal run of Lit bytes ending at pIn
+ * @return		new output index or 0 if it does not fit
+ */
+static size_t xBLzLiterals(const u8_t * pIn, size_t Lit, u8_t * pOut, size_t Op, size_t Max) {
+	while (Lit) {
+		size_t Now = (Lit > blzMAX_LIT) ? blzMAX_LIT : Lit;
+		if ((Op + 1 + Now) > Max)
+			return 0;
+		pOut[Op++] = Now - 1;
+		memcpy(pOut + Op, pIn - Lit, Now);
+		Op += Now;
+		Lit -= Now;
+	}
+	return Op;
+}
+
+// ################################### Global/public functions #####################################
+
+size_t xBLzPack(const u8_t * pIn, size_t Len, u8_t * pOut, size_t Max, u16_t * pHash) {
+	IF_myASSERT(debugPARAM, (pIn != NULL) && (pOut != NULL) && (pHash != NULL) && (Len <= blzMAX_BLOCK));
+	memset(pHash, 0, blzHASH_SIZE);						// 0 = empty, else position + 1
+	size_t Ip = 0, Op = 0, Lit = 0;
+	while ((Ip + 2) < Len) {
+		u32_t H = xBLzHash(pIn + Ip);
+		size_t Ref = pHash[H];
+		pHash[H] = Ip + 1;
+		if (Ref && ((Ip - Ref) < blzMAX_OFF) && (memcmp(pIn + Ref - 1, pIn + Ip, 3) == 0)) {
+			--Ref;
+			size_t Off = Ip - Ref - 1;
+			if (Lit && ((Op = xBLzLiterals(pIn + Ip, Lit, pOut, Op, Max)) == 0))
+				return 0;
+			Lit = 0;
+			size_t MaxRef = Len - Ip;
+			if (MaxRef > blzMAX_REF)
+				MaxRef = blzMAX_REF;
+			size_t Ml = 3;
+			while ((Ml < MaxRef) && (pIn[Ref + Ml] == pIn[Ip + Ml]))
+				++Ml;
+			size_t L = Ml - 2;
+			if ((Op + ((L < 7) ? 2 : 3)) > Max)
+				return 0;
+			if (L < 7) {
+				pOut[Op++] = (L << 5) | (Off >> 8);
+			} else {
+				pOut[Op++] = (7 << 5) | (Off >> 8);
+				pOut[Op++] = L - 7;
+			}
+			pOut[Op++] = Off & 0xFF;
+			Ip += Ml;
+			if ((Ip + 2) < Len)							// index the byte before the next probe
+				pHash[xBLzHash(pIn + Ip - 1)] = Ip;
+		} else {
+			++Lit;
+			++Ip;
+		}
+	}
+	Lit += Len - Ip;
+	return xBLzLiterals(pIn + Len, Lit, pOut, Op, Max);
+}
+
+size_t xBLzUnpack(const u8_t * pIn, size_t Len, u8_t * pOut, size_t Max) {
+	IF_myASSERT(debugPARAM, (pIn != NULL) && (pOut != NULL));
+	size_t Ip = 0, Op = 0;
+	while (Ip < Len) {
+		u8_t Ctrl = pIn[Ip++];
+		if (Ctrl < blzMAX_LIT) {						// literal run
+			size_t Now = Ctrl + 1;
+			if (((Ip + Now) > Len) || ((Op + Now) > Max))
+				return 0;
+			memcpy(pOut + Op, pIn + Ip, Now);
+			Ip += Now;
+			Op += Now;
+		} else {										// back reference
+			size_t L = Ctrl >> 5;
+			if (L == 7) {
+				if (Ip >= Len)
+					return 0;
+				L += pIn[Ip++];
+			}
+			L += 2;
+			if (Ip >= Len)
+				return 0;
+			size_t Off = (((Ctrl & 0x1F) << 8) | pIn[Ip++]) + 1;
+			if ((Off > Op) || ((Op + L) > Max))
+				return 0;
+			u8_t * pRef = pOut + Op - Off;
+			while (L--)									// byte wise, source may overlap
+				pOut[Op++] = *pRef++;
+		}
+	}
+	return Op;
+}
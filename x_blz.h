@@ -0,0 +1,49 @@
+// x_blz.h - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+/* Small LZ77 block codec (LZF compatible stream format) for retained buffer contents.
+ *		000LLLLL				literal run of L+1 bytes follows
+ *		LLLOOOOO oooooooo		match, length L+2 (L 1..6), offset OOOOOoooooooo+1
+ *		111OOOOO llllllll oooooooo	match, length l+9
+ * Compression needs a caller supplied hash table, decompression no state at all.
+ */
+
+#pragma	once
+
+#include "definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ##################################### MACRO definitions #########################################
+
+#define	blzHASH_BITS				10
+#define	blzHASH_SIZE				(sizeof(u16_t) << blzHASH_BITS)	// bytes of hash table
+#define	blzMAX_BLOCK				8192		// largest input block, hash holds u16_t positions
+
+// ################################### EXTERNAL FUNCTIONS ##########################################
+
+/**
+ * @brief		compress a block
+ * @param[in]	pIn - data to compress
+ * @param[in]	Len - number of bytes, maximum blzMAX_BLOCK
+ * @param[out]	pOut - buffer for compressed data
+ * @param[in]	Max - size of output buffer
+ * @param[in]	pHash - hash table, blzHASH_SIZE bytes, contents need not be preserved
+ * @return		compressed size or 0 if it would not fit in Max bytes
+ */
+size_t xBLzPack(const u8_t * pIn, size_t Len, u8_t * pOut, size_t Max, u16_t * pHash);
+
+/**
+ * @brief		decompress a block
+ * @param[in]	pIn - compressed data
+ * @param[in]	Len - number of compressed bytes
+ * @param[out]	pOut - buffer for decompressed data
+ * @param[in]	Max - size of output buffer
+ * @return		decompressed size or 0 if the data is corrupt or does not fit
+ */
+size_t xBLzUnpack(const u8_t * pIn, size_t Len, u8_t * pOut, size_t Max);
+
+#ifdef __cplusplus
+}
+#endif
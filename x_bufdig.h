@@ -0,0 +1,90 @@
+// x_bufdig.h - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+/* Running digest, updated by a buffer while data is copied in (write side) or out (drain side),
+ * avoiding a second pass over the data to checksum a record or flushed block.
+ */
+
+#pragma	once
+
+#include "definitions.h"
+
+#if defined(ESP_PLATFORM)
+	#include "esp_rom_crc.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ####################################### enumerations ############################################
+
+enum {												// where the buffer updates the digest
+	bufDIG_WRITE,									// data accepted by write
+	bufDIG_DRAIN,									// data read or accepted by the drain handler
+};
+
+// ####################################### structures  #############################################
+
+typedef u32_t (* bufdig_fn_t)(u32_t Digest, const void * pvBuf, size_t Len);
+
+typedef struct bufdig_t {
+	bufdig_fn_t fn;									// continue digest over Len bytes
+	u32_t Seed;										// value after reset
+	u32_t Value;									// running digest
+	u32_t Count;									// bytes digested since reset
+	u8_t Side;										// bufDIG_???
+} bufdig_t;
+
+// ################################### EXTERNAL FUNCTIONS ##########################################
+
+/**
+ * @brief		continue a CRC32 (IEEE 802.3, as zlib) over Len bytes, start with 0
+ */
+static inline u32_t xBufDigCRC32(u32_t CRC, const void * pvBuf, size_t Len) {
+#if defined(ESP_PLATFORM)
+	return esp_rom_crc32_le(CRC, pvBuf, Len);
+#else
+	const u8_t * pu8 = pvBuf;
+	CRC = ~CRC;
+	while (Len--) {
+		CRC ^= *pu8++;
+		for (int i = 0; i < 8; ++i)
+			CRC = (CRC >> 1) ^ (0xEDB88320UL & -(CRC & 1));
+	}
+	return ~CRC;
+#endif
+}
+
+/**
+ * @brief		initialise a digest control structure
+ * @param[in]	psD - pointer to digest structure, attach to ONE buffer only
+ * @param[in]	Side - bufDIG_WRITE or bufDIG_DRAIN
+ * @param[in]	fn - digest function, NULL for CRC32
+ * @param[in]	Seed - initial value, 0 for CRC32
+ */
+static inline void vBufDigInit(bufdig_t * psD, int Side, bufdig_fn_t fn, u32_t Seed) {
+	*psD = (bufdig_t) { .fn = fn ? fn : xBufDigCRC32, .Seed = Seed, .Value = Seed, .Side = Side };
+}
+
+/**
+ * @brief		called by the buffer, with the buffer locked, for every byte range copied
+ */
+static inline void vBufDigUpdate(bufdig_t * psD, const void * pvBuf, size_t Len) {
+	psD->Value = psD->fn(psD->Value, pvBuf, Len);
+	psD->Count += Len;
+}
+
+/**
+ * @brief		return the digest of the data since the last reset, and reset
+ * @note		to be called at a record/flush boundary, ie with no copy in progress
+ */
+static inline u32_t xBufDigReset(bufdig_t * psD) {
+	u32_t Value = psD->Value;
+	psD->Value = psD->Seed;
+	psD->Count = 0;
+	return Value;
+}
+
+#ifdef __cplusplus
+}
+#endif
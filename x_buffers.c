@@ -5,11 +5,14 @@
 #include "hal_stdio.h"
 #include "hal_nvic.h"
 #include "x_buffers.h"
+#include "x_bufser.h"
+#include "x_ubuf.h"
 #include "FreeRTOS_Support.h"
 #include "report.h"
 #include "syslog.h"
 #include "errors_events.h"
 
+#include <errno.h>
 #include <string.h>
 
 // ############################### BUILD: debug configuration options ##############################
@@ -151,6 +154,15 @@ static int vBufGivePointer(buf_t * psBuf) {
 	return erFAILURE;
 }
 
+/**
+ * @brief		update the digest, if attached, AFTER the critical section from caller owned memory
+ * @note		the CRC/hash never extends the time interrupts are disabled
+ */
+static void vBufDigest(buf_t * psBuf, int Side, const void * pvBuf, size_t Len) {
+	if (psBuf->psDig && (psBuf->psDig->Side == Side) && Len)
+		vBufDigUpdate(psBuf->psDig, pvBuf, Len);
+}
+
 int	xBufCompact(buf_t * psBuf) {
 	if (FF_STCHK(psBuf, FF_CIRCULAR) == 1 || FF_STCHK(psBuf, FF_MODEPACK) == 0) {
 		return erFAILURE;
@@ -166,6 +178,92 @@ int	xBufCompact(buf_t * psBuf) {
 	return psBuf->xSize - psBuf->xUsed;
 }
 
+/**
+ * @brief		space available for a write
+ * @param psBuf	pointer to the buffer control structure
+ * @param bContig	true if the space must be contiguous (xBufWrite) else total (xBufPutC)
+ * @return		number of bytes that can be written
+ */
+static size_t xBufRoom(buf_t * psBuf, bool bContig) {
+	if (bContig == false)
+		return psBuf->xSize - psBuf->xUsed;
+	if (FF_STCHK(psBuf, FF_MODEPACK))
+		xBufCompact(psBuf);
+	return psBuf->pEnd - psBuf->pWrite;
+}
+
+/**
+ * @brief		discard oldest buffered data, linear buffers are compacted to the start
+ * @param psBuf	pointer to the buffer control structure
+ * @param Req	number of bytes to discard
+ * @return		number of bytes actually discarded
+ */
+static size_t xBufDropOld(buf_t * psBuf, size_t Req) {
+	vBufIsrEntry(psBuf);
+	if (Req > psBuf->xUsed)
+		Req = psBuf->xUsed;
+	psBuf->xUsed -= Req;
+	psBuf->pRead += Req;
+	if (FF_STCHK(psBuf, FF_CIRCULAR)) {
+		if (psBuf->pRead >= psBuf->pEnd)
+			psBuf->pRead -= psBuf->xSize;				// correct for wrap
+	} else {
+		memmove(psBuf->pBeg, psBuf->pRead, psBuf->xUsed);
+		psBuf->pRead	= psBuf->pBeg;
+		psBuf->pWrite	= psBuf->pBeg + psBuf->xUsed;
+	}
+	vBufIsrExit(psBuf);
+	return Req;
+}
+
+/**
+ * @brief		apply the attached overflow policy, write of Req bytes does not fit
+ * @param psBuf	pointer to the buffer control structure
+ * @param Req	number of bytes to be written
+ * @param bContig	true if the space must be contiguous (xBufWrite) else total (xBufPutC)
+ * @return		number of bytes that may be written or bufOVF_DROP with errno set if write discarded
+ * @note		bufPOLICY_BLOCK cannot wait in an ISR, the write is then dropped as bufPOLICY_DROPNEW
+ */
+static ssize_t xBufOverflow(buf_t * psBuf, size_t Req, bool bContig) {
+	bufovf_t * psO = psBuf->psOvf;
+	size_t Room;
+	int Policy = psO->Policy;
+	if ((Policy == bufPOLICY_BLOCK) && xPortInIsrContext())
+		Policy = bufPOLICY_DROPNEW;
+	switch (Policy) {
+	case bufPOLICY_BLOCK: {
+		TickType_t tStart = xTaskGetTickCount();
+		while ((Room = xBufRoom(psBuf, bContig)) < Req) {
+			if ((xTaskGetTickCount() - tStart) >= pdMS_TO_TICKS(psO->msWait)) {
+				vBufOvfEvent(psO, psBuf, bufOVF_TIMEOUT, Req, 0, Req);
+				errno = ETIMEDOUT;
+				return bufOVF_DROP;
+			}
+			vBufOvfDelay();
+		}
+		vBufOvfEvent(psO, psBuf, bufOVF_BLOCKED, Req, Req, 0);
+		return Req;
+	}
+	case bufPOLICY_DROPNEW:
+		vBufOvfEvent(psO, psBuf, bufOVF_DROPNEW, Req, 0, Req);
+		errno = ENOSPC;
+		return bufOVF_DROP;
+
+	case bufPOLICY_DROPOLD: {
+		size_t Lost = xBufDropOld(psBuf, Req - xBufRoom(psBuf, bContig));
+		Room = xBufRoom(psBuf, bContig);				// Req > xSize still does not fit
+		if (Room > Req)
+			Room = Req;
+		vBufOvfEvent(psO, psBuf, bufOVF_DROPOLD, Req, Room, Lost + Req - Room);
+		return Room;
+	}
+	default:											// bufPOLICY_PARTIAL
+		Room = xBufRoom(psBuf, bContig);
+		vBufOvfEvent(psO, psBuf, bufOVF_PARTIAL, Req, Room, Req - Room);
+		return Room;
+	}
+}
+
 // ################################### Public/Global functions #####################################
 
 /**
@@ -210,6 +308,10 @@ static int xBufReuse(buf_t * psBuf, char * pBuf, size_t Size, u32_t flags, size_
 	psBuf->pBeg		= pBuf;
 	psBuf->pEnd		= pBuf + Size;						// calculate & save end
 	psBuf->xSize	= Size;
+	psBuf->psOvf	= NULL;
+	psBuf->psDig	= NULL;
+	psBuf->Head		= 0;
+	psBuf->Tail		= 0;
 // Only some flags to be carried forward...
 	FF_SET(psBuf, (flags & (FF_MODER | FF_MODEW | FF_MODERW | FF_MODEA | FF_MODEBIN | FF_CIRCULAR | FF_BUFFALOC)));
 	vBufIsrExit(psBuf);
@@ -223,9 +325,12 @@ static int xBufReuse(buf_t * psBuf, char * pBuf, size_t Size, u32_t flags, size_
  * @param Size	buffer size to use or create
  * @param flags	based on flags as defined, minimally implemented
  * @param Used	amount of data in buffer, available to be read
+ * @param psA	allocator to use if pBuf is 0, NULL for default
+ * @param Caps	ballocCAP_??? flags plus optional ballocALIGN(x), buffer only cleared if ballocCAP_ZERO
  * @return		pointer to the buffer handle or NULL if failed
+ * @note		memory is allocated outside the critical section, heap_caps may not be called inside
  */
-buf_t * psBufOpen(void * pBuf, size_t Size, u32_t flags, size_t Used) {
+buf_t * psBufOpenCaps(void * pBuf, size_t Size, u32_t flags, size_t Used, const balloc_t * psA, u32_t Caps) {
 	if ((pBuf == NULL) && (INRANGE(configBUFFERS_SIZE_MIN, Size, configBUFFERS_SIZE_MAX) == false)) {
 		myASSERT(0);
 		return pvFAILURE;
@@ -233,21 +338,126 @@ buf_t * psBufOpen(void * pBuf, size_t Size, u32_t flags, size_t Used) {
 	IF_myASSERT(debugPARAM, Used <= Size);
 	buf_t *	psBuf = vBufTakePointer();					// get a free table entry
 	if (psBuf != NULL) {								// unused entry found?
-		vBufIsrEntry(psBuf);
 		if (pBuf == 0) {
-			pBuf = malloc(Size);					// allocate memory for buffer
+			pBuf = pvBAllocType(psA, ballocTYPE_BUF, Size, Caps);	// allocate memory for buffer
+			if (pBuf == NULL)
+				return NULL;							// table entry still marked unused
 			flags |= FF_BUFFALOC;						// make sure flag is SET !!
-			memset(pBuf, 0, Size);
 			Used = 0;									// cannot have used something in a new buffer
 		} else {
 			flags &= ~FF_BUFFALOC;						// make sure flag is CLEAR !!
 		}
-		vBufIsrExit(psBuf);
 		xBufReuse(psBuf, pBuf, Size, flags, Used)	;	// setup
+		psBuf->psA = psA;
 	}
 	return psBuf;
 }
 
+/**
+ * @brief		allocate memory for the buffer and the control structure populate the control structure fields
+ * @param pBuf	pointer to the buffer memory to use, 0 to create new
+ * @param Size	buffer size to use or create
+ * @param flags	based on flags as defined, minimally implemented
+ * @param Used	amount of data in buffer, available to be read
+ * @return		pointer to the buffer handle or NULL if failed
+ */
+buf_t * psBufOpen(void * pBuf, size_t Size, u32_t flags, size_t Used) {
+	return psBufOpenCaps(pBuf, Size, flags, Used, NULL, ballocCAP_ZERO);
+}
+
+/**
+ * @brief		allocate a linear buffer with space reserved before and after the payload area
+ * @param Head	headroom, for headers added later with xBufPush()
+ * @param Size	payload area, used by the normal write functions
+ * @param Tail	tailroom, for trailers added later with xBufPut()
+ * @param flags	as for psBufOpen(), FF_CIRCULAR not allowed
+ * @return		pointer to the buffer handle, NULL if none available or pvFAILURE if parameters invalid
+ * @note		Reserved space is consumed by use, vBufReset() does not restore it
+ */
+buf_t * psBufOpenRoom(size_t Head, size_t Size, size_t Tail, u32_t flags) {
+	if ((flags & FF_CIRCULAR) || (Head > UINT16_MAX) || (Tail > UINT16_MAX)) {
+		errno = EINVAL;
+		return pvFAILURE;								// as psBufOpen() for an invalid size
+	}
+	buf_t * psBuf = psBufOpenCaps(NULL, Head + Size + Tail, flags, 0, NULL, ballocCAP_ZERO);
+	if ((psBuf == NULL) || (psBuf == pvFAILURE))
+		return psBuf;
+	vBufIsrEntry(psBuf);
+	psBuf->pBeg		+= Head;
+	psBuf->pEnd		-= Tail;
+	psBuf->pRead	= psBuf->pWrite = psBuf->pBeg;
+	psBuf->xSize	= Size;
+	psBuf->Head		= Head;
+	psBuf->Tail		= Tail;
+	vBufIsrExit(psBuf);
+	return psBuf;
+}
+
+/**
+ * @brief		prepend data, eg a protocol header, in front of the data to be read
+ * @param psBuf	pointer to the buffer control structure
+ * @param pvBuf	pointer to data to prepend
+ * @param Len	number of bytes
+ * @return		Len or erFAILURE with errno set if the free space before pRead plus headroom is short
+ * @note		Headroom used is moved into the buffer (pBeg moves down), not covered by a digest
+ */
+int xBufPush(buf_t * psBuf, const void * pvBuf, size_t Len) {
+	IF_EXEC_1(debugSTRUCTURE, xBufCheck, psBuf);
+	if (FF_STCHK(psBuf, FF_CIRCULAR)) {
+		errno = EINVAL;
+		return erFAILURE;
+	}
+	vBufIsrEntry(psBuf);
+	size_t Free = psBuf->pRead - psBuf->pBeg;			// already read, ie reusable
+	size_t Need = (Len > Free) ? (Len - Free) : 0;
+	if (Need > psBuf->Head) {
+		vBufIsrExit(psBuf);
+		errno = ENOSPC;
+		return erFAILURE;
+	}
+	psBuf->pBeg		-= Need;
+	psBuf->Head		-= Need;
+	psBuf->xSize	+= Need;
+	psBuf->pRead	-= Len;
+	psBuf->xUsed	+= Len;
+	memcpy(psBuf->pRead, pvBuf, Len);
+	vBufIsrExit(psBuf);
+	return Len;
+}
+
+/**
+ * @brief		append data, eg a protocol trailer, using tailroom if the buffer itself is full
+ * @param psBuf	pointer to the buffer control structure
+ * @param pvBuf	pointer to data to append
+ * @param Len	number of bytes, stored as is (no CR/LF expansion)
+ * @return		Len or erFAILURE with errno set if the space after pWrite plus tailroom is short
+ * @note		Tailroom used is moved into the buffer (pEnd moves up), no overflow policy applied
+ */
+int xBufPut(buf_t * psBuf, const void * pvBuf, size_t Len) {
+	IF_EXEC_1(debugSTRUCTURE, xBufCheck, psBuf);
+	if (FF_STCHK(psBuf, FF_CIRCULAR)) {
+		errno = EINVAL;
+		return erFAILURE;
+	}
+	vBufIsrEntry(psBuf);
+	size_t Free = psBuf->pEnd - psBuf->pWrite;
+	size_t Need = (Len > Free) ? (Len - Free) : 0;
+	if (Need > psBuf->Tail) {
+		vBufIsrExit(psBuf);
+		errno = ENOSPC;
+		return erFAILURE;
+	}
+	psBuf->pEnd		+= Need;
+	psBuf->Tail		-= Need;
+	psBuf->xSize	+= Need;
+	memcpy(psBuf->pWrite, pvBuf, Len);
+	psBuf->pWrite	+= Len;
+	psBuf->xUsed	+= Len;
+	vBufIsrExit(psBuf);
+	vBufDigest(psBuf, bufDIG_WRITE, pvBuf, Len);
+	return Len;
+}
+
 /**
  * @brief	deallocate the memory for the buffer and the control structure
  * @param	psBuf	pointer to the buffer control structure
@@ -256,20 +466,50 @@ buf_t * psBufOpen(void * pBuf, size_t Size, u32_t flags, size_t Used) {
 int	xBufClose(buf_t * psBuf) {
 	IF_EXEC_1(debugSTRUCTURE, xBufCheck, psBuf);
 	vBufIsrEntry(psBuf);
-	char *	pTmp = psBuf->pBeg;							// save pointer for later use..
+	char *	pTmp = psBuf->pBeg - psBuf->Head;			// save pointer for later use, start of headroom
+	size_t Size = psBuf->Head + psBuf->xSize + psBuf->Tail;	// as allocated
 	int iRV = vBufGivePointer(psBuf);
-	if ((iRV == erSUCCESS) && FF_STCHK(psBuf, FF_BUFFALOC)) {
+	bool bFree = (iRV == erSUCCESS) && FF_STCHK(psBuf, FF_BUFFALOC);
+	if (bFree) {
 	#if defined( __GNUC__ )
 		psBuf->_flags = 0;
 	#elif defined( __TI_ARM__ )
 		psBuf->flags = 0;
 	#endif
-		free(pTmp);										// return buffer
 	}
 	vBufIsrExit(psBuf);
+	if (bFree)
+		vBFreeType(psBuf->psA, ballocTYPE_BUF, pTmp, Size);	// return buffer, outside critical section
 	return iRV;
 }
 
+/**
+ * @brief		attach (or detach) an overflow policy to the buffer
+ * @param psBuf	pointer to the buffer control structure
+ * @param psO	pointer to initialised policy structure, NULL to revert to clip/EOF behaviour
+ * @note		bufPOLICY_BLOCK is allowed, an overflow found in an ISR drops the write instead
+ */
+void vBufSetPolicy(buf_t * psBuf, bufovf_t * psO) {
+	IF_myASSERT(debugPARAM, (psO == NULL) || (psO->Policy < bufPOLICY_NUMBER));
+	vBufIsrEntry(psBuf);
+	psBuf->psOvf = psO;
+	vBufIsrExit(psBuf);
+}
+
+/**
+ * @brief		attach (or detach) a running digest, updated during the copies in/out of the buffer
+ * @param psBuf	pointer to the buffer control structure
+ * @param psD	pointer to initialised digest, NULL to detach. bufDIG_WRITE covers bytes as stored
+ * 				(in text mode after CR/LF expansion), bufDIG_DRAIN bytes returned by xBufRead/GetC()
+ * @note		updated after the critical section, hence only one task or ISR may write (bufDIG_WRITE)
+ * 				or read (bufDIG_DRAIN) a digested buffer
+ */
+void vBufSetDigest(buf_t * psBuf, bufdig_t * psD) {
+	vBufIsrEntry(psBuf);
+	psBuf->psDig = psD;
+	vBufIsrExit(psBuf);
+}
+
 /**
  * @brief		get the number of characters in the buffer
  * @param psBuf	pointer to the buffer control structure
@@ -296,7 +536,7 @@ size_t xBufSpace(buf_t * psBuf) {
  * @brief		buffer and control structure MUST have been created prior
  * @param psBuf pointer to buffer control structure
  * @param cChr	the char to be written
- * @return		cChr if the char was written or EOF if discarded/overwritten
+ * @return		cChr if the char was written or EOF with errno set if no space or discarded by policy
  */
 int	xBufPutC(int cChr, buf_t * psBuf) {
 	IF_EXEC_1(debugSTRUCTURE, xBufCheck, psBuf);
@@ -305,13 +545,19 @@ int	xBufPutC(int cChr, buf_t * psBuf) {
 		iRV = xBufPutC(CHR_CR, psBuf);
 		if (iRV == EOF) return iRV;
 	}
+	if ((psBuf->xSize == psBuf->xUsed) && psBuf->psOvf && (psBuf->psOvf->Policy != bufPOLICY_LEGACY)) {
+		if (xBufOverflow(psBuf, 1, false) == bufOVF_DROP)
+			return EOF;									// discarded by policy, errno set
+	}
 	if (psBuf->xSize > psBuf->xUsed) {
 		vBufIsrEntry(psBuf);
-		*psBuf->pWrite++ = cChr;							// Firstly store char in buffer
+		*psBuf->pWrite++ = cChr;						// Firstly store char in buffer
 		psBuf->xUsed++;									// & adjust the Used counter
 		if (psBuf->pWrite == psBuf->pEnd)					// Last character written in last slot &
 			psBuf->pWrite = psBuf->pBeg;					// yes, wrap write pointer to start
 		vBufIsrExit(psBuf);
+		u8_t u8Chr = cChr;
+		vBufDigest(psBuf, bufDIG_WRITE, &u8Chr, sizeof(u8Chr));
 		iRV = cChr;
 	} else {
 		iRV = EOF;
@@ -340,6 +586,8 @@ int	xBufGetC(buf_t * psBuf) {
 		}
 	}
 	vBufIsrExit(psBuf);
+	u8_t u8Chr = cChr;
+	vBufDigest(psBuf, bufDIG_DRAIN, &u8Chr, sizeof(u8Chr));
 	return cChr;
 }
 
@@ -385,6 +633,53 @@ char * pcBufGetS(char * pBuf, int Number, buf_t * psBuf) {
 	return pBuf;										// and return a valid state
 }
 
+/**
+ * @brief		copy text to the buffer expanding LF to CR/LF, never splitting a CR/LF pair
+ * @param psBuf	pointer to the buffer structure
+ * @param pcSrc	pointer to text to be added
+ * @param Len	number of bytes of text
+ * @param Room	contiguous space available at pWrite
+ * @return		number of source bytes consumed, each LF counted once
+ * @note		Runs between LFs are copied with memcpy, all inside ONE critical section, stops
+ * 				when Room runs out, never splitting a CR/LF pair.
+ */
+static size_t xBufWriteText(buf_t * psBuf, const char * pcSrc, size_t Len, size_t Room) {
+	const char * pcNow = pcSrc;
+	const char * pcEnd = pcSrc + Len;
+	vBufIsrEntry(psBuf);
+	char * pcDst = psBuf->pWrite;
+	while ((pcNow < pcEnd) && Room) {
+		const char * pcLF = memchr(pcNow, CHR_LF, pcEnd - pcNow);
+		size_t Run = (pcLF ? pcLF : pcEnd) - pcNow;
+		if (Run > Room)
+			Run = Room;
+		memcpy(pcDst, pcNow, Run);
+		pcDst += Run;
+		pcNow += Run;
+		Room -= Run;
+		if ((pcNow != pcLF) || (Room < 2))				// no LF here, or no space for CR/LF
+			break;
+		*pcDst++ = CHR_CR;
+		*pcDst++ = CHR_LF;
+		++pcNow;
+		Room -= 2;
+	}
+	psBuf->xUsed += pcDst - psBuf->pWrite;
+	psBuf->pWrite = pcDst;
+	vBufIsrExit(psBuf);
+	if (psBuf->psDig && (psBuf->psDig->Side == bufDIG_WRITE)) {	// as stored, from the source
+		for (const char * pcRun = pcSrc; pcRun < pcNow; ) {
+			const char * pcLF = memchr(pcRun, CHR_LF, pcNow - pcRun);
+			vBufDigest(psBuf, bufDIG_WRITE, pcRun, (pcLF ? pcLF : pcNow) - pcRun);
+			if (pcLF == NULL)
+				break;
+			vBufDigest(psBuf, bufDIG_WRITE, "\r\n", 2);
+			pcRun = pcLF + 1;
+		}
+	}
+	return pcNow - pcSrc;
+}
+
 /**
  * @brief		add 1 or more structures to the packet payload
  * @param pvBuf	pointer to new payload data
@@ -392,6 +687,9 @@ char * pcBufGetS(char * pBuf, int Number, buf_t * psBuf) {
  * @param Count	of items of the structure/unit to be added
  * @param psBuf	pointer to the buffer structure
  * @return		number of bytes allocated to buffer or an error code
+ * @note		with an overflow policy attached, a dropped write returns 0 with errno set
+ * @note		in text mode (FF_MODEBIN clear) LF is expanded to CR/LF, as xBufPutC() does, until
+ * 				space runs out. The number of source bytes consumed is returned, not bytes stored.
  */
 size_t xBufWrite(void * pvBuf, size_t Size, size_t Count, buf_t * psBuf) {
 	IF_EXEC_1(debugSTRUCTURE, xBufCheck, psBuf);
@@ -404,13 +702,23 @@ size_t xBufWrite(void * pvBuf, size_t Size, size_t Count, buf_t * psBuf) {
 	Count *= Size;										// calculate requested number of BYTES
 	if (Count > (psBuf->pEnd - psBuf->pWrite)) {		// write size bigger than available to end?
 		xBufCompact(psBuf);							// compact up, if possible
-		Count = psBuf->pEnd - psBuf->pWrite;			// then adjust...
+		if ((Count > (psBuf->pEnd - psBuf->pWrite)) && psBuf->psOvf && (psBuf->psOvf->Policy != bufPOLICY_LEGACY)) {
+			ssize_t sRV = xBufOverflow(psBuf, Count, true);
+			if (sRV == bufOVF_DROP)
+				return 0;								// discarded by policy, errno set
+		}
 	}
+	size_t Room = psBuf->pEnd - psBuf->pWrite;
+	if (FF_STCHK(psBuf, FF_MODEBIN) == 0)
+		return xBufWriteText(psBuf, pvBuf, Count, Room);
+	if (Count > Room)
+		Count = Room;									// then adjust...
 	vBufIsrEntry(psBuf);
 	memcpy(psBuf->pWrite, pvBuf, Count);				// move contents across
 	psBuf->pWrite	+= Count;							// update the payload pointers and length counters
 	psBuf->xUsed	+= Count;
 	vBufIsrExit(psBuf);
+	vBufDigest(psBuf, bufDIG_WRITE, pvBuf, Count);
 	return Count;
 }
 
@@ -446,6 +754,7 @@ size_t xBufRead(void * pvBuf, size_t Size, size_t Count, buf_t * psBuf) {
 		psBuf->pRead = psBuf->pWrite = psBuf->pBeg;	// reset all to start
 	}
 	vBufIsrExit(psBuf);
+	vBufDigest(psBuf, bufDIG_DRAIN, pvBuf, Count);
 	return Count;
 }
 
@@ -571,6 +880,116 @@ int	xBufPrintClose(buf_t * psBuf) {
 	return iRV;
 }
 
+/**
+ * @brief		fill handler for xUBufWriteFill(), copies readable data straight into the ubuf_t
+ */
+static size_t xBufTake(void * pvCtx, u8_t * pDst, size_t Len) {
+	buf_t * psBuf = pvCtx;
+	size_t Done = 0;
+	vBufIsrEntry(psBuf);
+	while ((Done < Len) && psBuf->xUsed) {				// linear once, circular at most twice
+		size_t Now = psBuf->pEnd - psBuf->pRead;
+		if (Now > psBuf->xUsed)
+			Now = psBuf->xUsed;
+		if (Now > (Len - Done))
+			Now = Len - Done;
+		memcpy(pDst + Done, psBuf->pRead, Now);
+		psBuf->pRead += Now;
+		psBuf->xUsed -= Now;
+		Done += Now;
+		if (psBuf->pRead == psBuf->pEnd)
+			psBuf->pRead = psBuf->pBeg;
+	}
+	if ((psBuf->xUsed == 0) && (FF_STCHK(psBuf, FF_CIRCULAR) == 0))
+		psBuf->pRead = psBuf->pWrite = psBuf->pBeg;		// reset all to start
+	vBufIsrExit(psBuf);
+	vBufDigest(psBuf, bufDIG_DRAIN, pDst, Done);		// segments are contiguous in pDst
+	return Done;
+}
+
+/**
+ * @brief		move up to Max bytes from the buffer into a ubuf_t, without intermediate copies
+ * @param psDst	destination, only the space free now is used
+ * @param psSrc	source buffer
+ * @param Max	maximum bytes to move, 0 = as much as possible
+ * @return		number of bytes moved, less than requested if the destination filled up, or
+ * 				the xUBufWriteFill() error if the destination is invalid or could not be allocated
+ * @note		The ubuf_t is locked before (each) buffer critical section, at most 4 memcpy
+ */
+ssize_t xBufSpliceToUBuf(struct ubuf_t * psDst, buf_t * psSrc, size_t Max) {
+	IF_EXEC_1(debugSTRUCTURE, xBufCheck, psSrc);
+	if ((Max == 0) || (Max > psSrc->xUsed))
+		Max = psSrc->xUsed;
+	if (Max == 0)
+		return 0;
+	return xUBufWriteFill(psDst, Max, xBufTake, psSrc);
+}
+
+bool bBufSerBegin(bufser_t * psS, buf_t * psBuf, size_t Need) {
+	IF_EXEC_1(debugSTRUCTURE, xBufCheck, psBuf);
+	*psS = (bufser_t) { .psBuf = psBuf, .f_err = 1 };
+	if (FF_STCHK(psBuf, FF_CIRCULAR)) {
+		errno = EINVAL;
+		return false;
+	}
+	if (Need > (psBuf->pEnd - psBuf->pWrite))			// not enough contiguous space?
+		xBufCompact(psBuf);								// compact up, if possible
+	psS->pBeg = psS->pNow = (u8_t *) psBuf->pWrite;
+	psS->pLim = (u8_t *) psBuf->pEnd;
+	psS->f_err = (Need > (psS->pLim - psS->pNow));
+	if (psS->f_err)
+		errno = ENOSPC;
+	return !psS->f_err;
+}
+
+size_t xBufSerCommit(bufser_t * psS) {
+	buf_t * psBuf = psS->psBuf;
+	if (psS->f_err || ((char *) psS->pBeg != psBuf->pWrite)) {	// failed, or buffer written meanwhile
+		errno = psS->f_err ? ENOSPC : EBUSY;
+		return 0;
+	}
+	size_t Len = psS->pNow - psS->pBeg;
+	vBufDigest(psBuf, bufDIG_WRITE, psS->pBeg, Len);	// not yet visible, still ours
+	vBufIsrEntry(psBuf);
+	psBuf->pWrite += Len;
+	psBuf->xUsed += Len;
+	vBufIsrExit(psBuf);
+	psS->pBeg = psS->pNow;								// allow a follow on batch
+	return Len;
+}
+
+bool bBufSerOpen(bufser_t * psS, buf_t * psBuf) {
+	IF_EXEC_1(debugSTRUCTURE, xBufCheck, psBuf);
+	*psS = (bufser_t) { .psBuf = psBuf, .f_err = 1 };
+	if (FF_STCHK(psBuf, FF_CIRCULAR)) {
+		errno = EINVAL;
+		return false;
+	}
+	psS->pBeg = psS->pNow = (u8_t *) psBuf->pRead;
+	psS->pLim = psS->pBeg + psBuf->xUsed;
+	psS->f_err = 0;
+	return true;
+}
+
+size_t xBufSerConsume(bufser_t * psS) {
+	buf_t * psBuf = psS->psBuf;
+	if (psS->f_err || ((char *) psS->pBeg != psBuf->pRead)) {	// failed, or buffer read meanwhile
+		errno = psS->f_err ? ENODATA : EBUSY;
+		return 0;
+	}
+	size_t Len = psS->pNow - psS->pBeg;
+	vBufDigest(psBuf, bufDIG_DRAIN, psS->pBeg, Len);	// not yet released, still ours
+	vBufIsrEntry(psBuf);
+	psBuf->pRead += Len;
+	psBuf->xUsed -= Len;
+	if (psBuf->xUsed == 0)
+		psBuf->pRead = psBuf->pWrite = psBuf->pBeg;		// reset all to start
+	vBufIsrExit(psBuf);
+	psS->pBeg = psS->pNow = (u8_t *) psBuf->pRead;		// allow a follow on batch
+	psS->pLim = psS->pBeg + psBuf->xUsed;
+	return Len;
+}
+
 /**
  * @brief	output buffer contents to syslog host and close the buffer
  * @param	pointer to the managed buffer to be printed
@@ -668,4 +1087,96 @@ void vBufUnitTest(void) {
 	if ((xBufAvail(psBuf) != bufSIZE) || (xBufSpace(psBuf) != 0))				PX("Failed");
 	PX("25 at End\r\n%!'+hhY", xBufAvail(psBuf), pcBufTellPointer(psBuf, FF_MODER));
 	xBufClose(psBuf);
+
+	// text mode: LF expanded to CR/LF, source bytes consumed returned, CR/LF never split
+	psBuf = psBufOpen(0, 64, FF_MODER|FF_MODEW, 0);
+	if (xBufWrite("ab\ncd\n", 1, 6, psBuf) != 6)								PX("Failed");
+	if ((xBufAvail(psBuf) != 8) || memcmp(psBuf->pRead, "ab\r\ncd\r\n", 8))	PX("Failed");
+	memset(cBuffer, CHR_0, sizeof(cBuffer));
+	if (xBufWrite(cBuffer, 5, 10, psBuf) != 50)									PX("Failed");
+	if (xBufWrite(cBuffer, 1, 5, psBuf) != 5)									PX("Failed");
+	if ((xBufWrite("\n", 1, 1, psBuf) != 0) || (xBufSpace(psBuf) != 1))		PX("Failed");
+	xBufClose(psBuf);
+	// binary mode: written as is
+	psBuf = psBufOpen(0, 64, FF_MODER|FF_MODEW|FF_MODEBIN, 0);
+	if ((xBufWrite("ab\ncd\n", 1, 6, psBuf) != 6) || (xBufAvail(psBuf) != 6))	PX("Failed");
+	xBufClose(psBuf);
+
+	// running digest: standard check value, split update, bytes as stored and as drained
+	if (xBufDigCRC32(0, "123456789", 9) != 0xCBF43926UL)						PX("Failed");
+	if (xBufDigCRC32(xBufDigCRC32(0, "1234", 4), "56789", 5) != 0xCBF43926UL)	PX("Failed");
+	bufdig_t sW, sD;
+	psBuf = psBufOpen(0, 64, FF_MODER|FF_MODEW, 0);
+	vBufDigInit(&sW, bufDIG_WRITE, NULL, 0);
+	vBufSetDigest(psBuf, &sW);
+	xBufWrite("ab\n", 1, 3, psBuf);
+	xBufPutC('x', psBuf);
+	if ((sW.Count != 5) || (sW.Value != xBufDigCRC32(0, "ab\r\nx", 5)))		PX("Failed");
+	vBufDigInit(&sD, bufDIG_DRAIN, NULL, 0);
+	vBufSetDigest(psBuf, &sD);
+	xBufRead(cBuffer, 1, 2, psBuf);
+	xBufGetC(psBuf);
+	if ((sD.Count != 3) || (xBufDigReset(&sD) != xBufDigCRC32(0, "ab\r", 3)))	PX("Failed");
+	vBufSetDigest(psBuf, NULL);
+
+	// splice into a ubuf_t, only the space free there is used
+	ubuf_t * psUB = psUBufCreate(NULL, NULL, 32, 0);
+	vBufReset(psBuf, 0);
+	memset(cBuffer, CHR_0, sizeof(cBuffer));
+	xBufWrite(cBuffer, 1, 40, psBuf);
+	if (psUB == NULL) {
+		PX("Failed");
+	} else {
+		if ((xBufSpliceToUBuf(psUB, psBuf, 0) != 32) || (xBufAvail(psBuf) != 8))	PX("Failed");
+		xUBufRead(psUB, cBuffer, 32);
+		if ((xBufSpliceToUBuf(psUB, psBuf, 0) != 8) || (xBufAvail(psBuf) != 0))	PX("Failed");
+		vUBufDestroy(psUB);
+	}
+	xBufClose(psBuf);
+
+	// serialisation: round trip, then malformed varint and string length
+	bufser_t sS;
+	size_t Len = 0;
+	psBuf = psBufOpen(0, 64, FF_MODER|FF_MODEW|FF_MODEBIN, 0);
+	if (bBufSerBegin(&sS, psBuf, 24)) {
+		vBufSerPutU16BE(&sS, 0x1234);
+		vBufSerPutVarS(&sS, -300);
+		vBufSerPutStr(&sS, "hey", 3);
+	}
+	if (xBufSerCommit(&sS) != 2 + 2 + 1 + 3)									PX("Failed");
+	bBufSerOpen(&sS, psBuf);
+	if ((xBufSerGetU16BE(&sS) != 0x1234) || (xBufSerGetVarS(&sS) != -300))		PX("Failed");
+	const char * pcStr = pcBufSerGetStr(&sS, &Len);
+	if ((pcStr == NULL) || (Len != 3) || memcmp(pcStr, "hey", 3))				PX("Failed");
+	if ((xBufSerConsume(&sS) != 8) || xBufAvail(psBuf))							PX("Failed");
+	memset(cBuffer, 0xFF, 11);													// continuation bit never clears
+	xBufWrite(cBuffer, 1, 11, psBuf);
+	bBufSerOpen(&sS, psBuf);
+	xBufSerGetVar(&sS);
+	if (!sS.f_err || xBufSerConsume(&sS))										PX("Failed");
+	vBufReset(psBuf, 0);
+	if (bBufSerBegin(&sS, psBuf, 8)) {
+		vBufSerPutVar(&sS, 100);												// claims more than follows
+		vBufSerPutU16BE(&sS, 0x4142);
+		xBufSerCommit(&sS);
+	}
+	bBufSerOpen(&sS, psBuf);
+	if ((pcBufSerGetStr(&sS, &Len) != NULL) || Len || !sS.f_err)				PX("Failed");
+	xBufClose(psBuf);
+
+	// headroom and tailroom: header and trailer added around the payload without moving it
+	if (psBufOpenRoom(8, 64, 4, FF_MODER|FF_CIRCULAR) != pvFAILURE)			PX("Failed");
+	psBuf = psBufOpenRoom(8, 64, 4, FF_MODER|FF_MODEW|FF_MODEBIN);
+	if ((psBuf == NULL) || (psBuf == pvFAILURE)) {
+		PX("Failed");
+		return;
+	}
+	memset(cBuffer, CHR_0, sizeof(cBuffer));
+	char * pcPayload = psBuf->pBeg;
+	if ((xBufWrite(cBuffer, 1, 50, psBuf) != 50) || (xBufWrite(cBuffer, 1, 14, psBuf) != 14))	PX("Failed");
+	if ((xBufPush(psBuf, "HDR:", 4) != 4) || (xBufPush(psBuf, "IPv4/", 5) != erFAILURE))	PX("Failed");
+	if ((xBufPut(psBuf, "CRC!", 4) != 4) || (xBufPut(psBuf, "x", 1) != erFAILURE))	PX("Failed");
+	if ((psBuf->pRead != pcPayload - 4) || (psBuf->xUsed != 4 + 64 + 4))		PX("Failed");
+	if (memcmp(psBuf->pRead, "HDR:0", 5) || memcmp(psBuf->pRead + 68, "CRC!", 4))	PX("Failed");
+	xBufClose(psBuf);
 }
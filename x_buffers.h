@@ -3,6 +3,9 @@
 #pragma once
 
 #include "definitions.h"
+#include "x_balloc.h"
+#include "x_bufdig.h"
+#include "x_bufovf.h"
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -11,8 +14,16 @@ extern "C" {
 
 // ############################## Heap and memory de/allocation related ############################
 
+#ifndef configBUFFERS_WIDE_INDEX
+	#define	configBUFFERS_WIDE_INDEX			0		// 1 = multi-MB (PSRAM) buffers
+#endif
+
 #define	configBUFFERS_SIZE_MIN					64
-#define	configBUFFERS_SIZE_MAX					32768
+#if (configBUFFERS_WIDE_INDEX > 0)
+	#define	configBUFFERS_SIZE_MAX				(32 * 1024 * 1024)
+#else
+	#define	configBUFFERS_SIZE_MAX				32768
+#endif
 #define	configBUFFERS_MAX_OPEN					10
 
 // ################################## Macros to simplify access ####################################
@@ -47,8 +58,13 @@ typedef struct buf_s {
     size_t xUsed;
     size_t xSize;
 	int handle;
+	bufovf_t * psOvf;						// optional overflow policy, NULL = clip/EOF
+	const balloc_t * psA;					// allocator used for pBeg, if FF_BUFFALOC
+	bufdig_t * psDig;						// optional running digest, write or read side
+	u16_t Head;								// headroom left below pBeg, see xBufPush()
+	u16_t Tail;								// tailroom left above pEnd, see xBufPut()
 } buf_t;
-DUMB_STATIC_ASSERT(sizeof(buf_t) == 32);
+DUMB_STATIC_ASSERT(sizeof(buf_t) == 48);
 
 // #################################################################################################
 
@@ -57,7 +73,16 @@ int	xBufGive(void * pvBuf);
 int	xBufReport(buf_t * psBuf);
 void vBufReset( buf_t * psBuf, size_t Used);
 buf_t *	psBufOpen(void * pBuf, size_t Size, uint32_t flags, size_t Used);
+buf_t * psBufOpenCaps(void * pBuf, size_t Size, uint32_t flags, size_t Used, const balloc_t * psA, uint32_t Caps);
+buf_t * psBufOpenRoom(size_t Head, size_t Size, size_t Tail, uint32_t flags);
+int xBufPush(buf_t * psBuf, const void * pvBuf, size_t Len);
+int xBufPut(buf_t * psBuf, const void * pvBuf, size_t Len);
 int	xBufClose(buf_t * psBuf);
+void vBufSetPolicy(buf_t * psBuf, bufovf_t * psO);
+void vBufSetDigest(buf_t * psBuf, bufdig_t * psD);
+
+struct ubuf_t;
+ssize_t xBufSpliceToUBuf(struct ubuf_t * psDst, buf_t * psSrc, size_t Max);
 
 size_t xBufAvail(buf_t * psBuf);
 size_t xBufSpace(buf_t * psBuf);
@@ -0,0 +1,89 @@
+// x_bufovf.h - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+#pragma	once
+
+#include "definitions.h"
+#include "FreeRTOS_Support.h"
+#include "systiming.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ##################################### MACRO definitions #########################################
+
+#define	bufOVF_DROP					(-2)		// internal: write discarded, caller returns 0 (EOF for PutC)
+
+// ####################################### enumerations ############################################
+
+enum {												// what to do if a write does not fit
+	bufPOLICY_LEGACY,								// buffer specific flags (O_TRUNC, O_NONBLOCK etc)
+	bufPOLICY_BLOCK,								// wait up to msWait for space, then drop newest (DROPNEW in ISR)
+	bufPOLICY_DROPNEW,								// discard the write that does not fit
+	bufPOLICY_DROPOLD,								// discard oldest buffered data to make space
+	bufPOLICY_PARTIAL,								// write as much as fits, return short count
+	bufPOLICY_NUMBER
+};
+
+enum {												// overflow event counters
+	bufOVF_BLOCKED,									// waited, space became available
+	bufOVF_TIMEOUT,									// waited, timed out hence dropped
+	bufOVF_DROPNEW,
+	bufOVF_DROPOLD,
+	bufOVF_PARTIAL,
+	bufOVF_NUMBER
+};
+
+// ####################################### structures  #############################################
+
+typedef struct bufovf_t {
+	void (*cb)(void * pvBuf, int Event, size_t Req, size_t Done);	// optional, called on every event
+	u32_t Count[bufOVF_NUMBER];						// events, by outcome
+	u32_t Lost;										// bytes discarded, old or new
+	u16_t msWait;									// bufPOLICY_BLOCK maximum wait
+	u8_t Policy;
+} bufovf_t;
+
+// ################################### EXTERNAL FUNCTIONS ##########################################
+
+/**
+ * @brief		initialise an overflow policy control structure
+ * @param[in]	psO - pointer to policy structure, can be shared by multiple buffers
+ * @param[in]	Policy - bufPOLICY_??? value
+ * @param[in]	msWait - maximum wait for bufPOLICY_BLOCK
+ * @param[in]	cb - optional callback, called with buffer, event, bytes requested and bytes written
+ */
+static inline void vBufOvfInit(bufovf_t * psO, int Policy, u16_t msWait, void (*cb)(void *, int, size_t, size_t)) {
+	*psO = (bufovf_t) { .cb = cb, .msWait = msWait, .Policy = Policy };
+}
+
+/**
+ * @brief		record an overflow event and notify the owner, if a callback is registered
+ * @param[in]	psO - pointer to policy structure
+ * @param[in]	pvBuf - buffer on which the event occurred
+ * @param[in]	Event - bufOVF_??? value
+ * @param[in]	Req - number of bytes the write requested
+ * @param[in]	Done - number of new bytes actually stored
+ * @param[in]	Lost - number of bytes (old or new) discarded
+ */
+static inline void vBufOvfEvent(bufovf_t * psO, void * pvBuf, int Event, size_t Req, size_t Done, size_t Lost) {
+	++psO->Count[Event];
+	psO->Lost += Lost;
+	if (psO->cb)
+		psO->cb(pvBuf, Event, Req, Done);
+}
+
+/**
+ * @brief		short wait for space or data to become available, also before the scheduler runs
+ */
+static inline void vBufOvfDelay(void) {
+	if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+		vTaskDelay(pdMS_TO_TICKS(2));
+	} else {
+		vClockDelayMsec(2);
+	}
+}
+
+#ifdef __cplusplus
+}
+#endif
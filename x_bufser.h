@@ -0,0 +1,229 @@
+// x_bufser.h - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+/* Binary serialisation cursor over a (linear) buf_t. A batch is opened once, with one capacity check
+ * and no lock, the inline put/get helpers then work directly at pWrite/pRead bounded by the cursor
+ * limit, and the batch is committed (or consumed) once, inside a single critical section.
+ *
+ * Errors are sticky: a put/get that does not fit sets f_err and does nothing, the batch can then be
+ * checked once at the end. A failed batch is neither committed nor consumed.
+ *
+ * Varints are unsigned LEB128 (7 bits per byte, LSB first), strings/blobs are prefixed by a varint
+ * length. Only ONE cursor may be open on a buffer at a time, batches are not thread safe.
+ */
+
+#pragma	once
+
+#include "x_buffers.h"
+
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ##################################### MACRO definitions #########################################
+
+#define	bufserVAR_MAX				10			// longest u64_t varint
+
+// ####################################### structures  #############################################
+
+typedef struct bufser_t {
+	buf_t * psBuf;
+	u8_t * pBeg;					// pWrite (encode) or pRead (decode) when opened
+	u8_t * pNow;					// next byte to write/read
+	u8_t * pLim;					// end of contiguous space (encode) or data (decode)
+	bool f_err;						// overflow (encode) or underflow/malformed (decode)
+} bufser_t;
+
+// ################################### EXTERNAL FUNCTIONS ##########################################
+
+/**
+ * @brief		open an encode batch at pWrite, compacting the buffer if required
+ * @param[in]	psS - pointer to cursor
+ * @param[in]	psBuf - linear (not FF_CIRCULAR) buffer
+ * @param[in]	Need - bytes the batch is expected to require, more may be written if space allows
+ * @return		true if Need bytes are available, else false with errno set (cursor in error)
+ */
+bool bBufSerBegin(bufser_t * psS, buf_t * psBuf, size_t Need);
+
+/**
+ * @brief		make the bytes put since bBufSerBegin() part of the buffer content
+ * @return		number of bytes added, 0 with errno set if the batch failed
+ */
+size_t xBufSerCommit(bufser_t * psS);
+
+/**
+ * @brief		open a decode batch over the data available at pRead
+ * @return		true if successful, false with errno set if FF_CIRCULAR
+ */
+bool bBufSerOpen(bufser_t * psS, buf_t * psBuf);
+
+/**
+ * @brief		remove the bytes got since bBufSerOpen() from the buffer
+ * @return		number of bytes consumed, 0 with errno set if the batch failed
+ */
+size_t xBufSerConsume(bufser_t * psS);
+
+// ###################################### Inline encoders ##########################################
+
+/**
+ * @brief		reserve Len bytes at the cursor
+ * @return		pointer to the reserved bytes, NULL if they do not fit (error set)
+ */
+static inline u8_t * pBufSerReserve(bufser_t * psS, size_t Len) {
+	if (psS->f_err || (Len > (size_t) (psS->pLim - psS->pNow))) {
+		psS->f_err = 1;
+		return NULL;
+	}
+	u8_t * pu8 = psS->pNow;
+	psS->pNow += Len;
+	return pu8;
+}
+
+static inline void vBufSerPutU8(bufser_t * psS, u8_t Val) {
+	u8_t * pu8 = pBufSerReserve(psS, 1);
+	if (pu8)
+		*pu8 = Val;
+}
+
+static inline void vBufSerPutLE(bufser_t * psS, u64_t Val, int Len) {
+	u8_t * pu8 = pBufSerReserve(psS, Len);
+	if (pu8) {
+		for (int i = 0; i < Len; ++i, Val >>= 8)
+			pu8[i] = Val;
+	}
+}
+
+static inline void vBufSerPutBE(bufser_t * psS, u64_t Val, int Len) {
+	u8_t * pu8 = pBufSerReserve(psS, Len);
+	if (pu8) {
+		for (int i = Len - 1; i >= 0; --i, Val >>= 8)
+			pu8[i] = Val;
+	}
+}
+
+static inline void vBufSerPutU16LE(bufser_t * psS, u16_t Val) { vBufSerPutLE(psS, Val, sizeof(u16_t)); }
+static inline void vBufSerPutU16BE(bufser_t * psS, u16_t Val) { vBufSerPutBE(psS, Val, sizeof(u16_t)); }
+static inline void vBufSerPutU32LE(bufser_t * psS, u32_t Val) { vBufSerPutLE(psS, Val, sizeof(u32_t)); }
+static inline void vBufSerPutU32BE(bufser_t * psS, u32_t Val) { vBufSerPutBE(psS, Val, sizeof(u32_t)); }
+static inline void vBufSerPutU64LE(bufser_t * psS, u64_t Val) { vBufSerPutLE(psS, Val, sizeof(u64_t)); }
+static inline void vBufSerPutU64BE(bufser_t * psS, u64_t Val) { vBufSerPutBE(psS, Val, sizeof(u64_t)); }
+
+static inline void vBufSerPutVar(bufser_t * psS, u64_t Val) {
+	u8_t caTmp[bufserVAR_MAX];
+	int Len = 0;
+	do {
+		caTmp[Len++] = (Val & 0x7F) | ((Val > 0x7F) ? 0x80 : 0);
+		Val >>= 7;
+	} while (Val);
+	u8_t * pu8 = pBufSerReserve(psS, Len);
+	if (pu8)
+		memcpy(pu8, caTmp, Len);
+}
+
+/**
+ * @brief		signed varint, zigzag mapped so small negative values stay short
+ */
+static inline void vBufSerPutVarS(bufser_t * psS, i64_t Val) {
+	vBufSerPutVar(psS, ((u64_t) Val << 1) ^ (u64_t) (Val >> 63));
+}
+
+static inline void vBufSerPutBlob(bufser_t * psS, const void * pvBuf, size_t Len) {
+	u8_t * pu8 = pBufSerReserve(psS, Len);
+	if (pu8)
+		memcpy(pu8, pvBuf, Len);
+}
+
+/**
+ * @brief		varint length followed by the bytes, no terminator
+ */
+static inline void vBufSerPutStr(bufser_t * psS, const char * pccStr, size_t Len) {
+	vBufSerPutVar(psS, Len);
+	vBufSerPutBlob(psS, pccStr, Len);
+}
+
+// ###################################### Inline decoders ##########################################
+
+/**
+ * @brief		take Len bytes at the cursor
+ * @return		pointer to the bytes, NULL if not available (error set)
+ */
+static inline const u8_t * pBufSerTake(bufser_t * psS, size_t Len) {
+	return pBufSerReserve(psS, Len);				// same bounds, pLim is the end of data
+}
+
+static inline u8_t xBufSerGetU8(bufser_t * psS) {
+	const u8_t * pu8 = pBufSerTake(psS, 1);
+	return pu8 ? *pu8 : 0;
+}
+
+static inline u64_t xBufSerGetLE(bufser_t * psS, int Len) {
+	const u8_t * pu8 = pBufSerTake(psS, Len);
+	u64_t Val = 0;
+	if (pu8) {
+		for (int i = Len - 1; i >= 0; --i)
+			Val = (Val << 8) | pu8[i];
+	}
+	return Val;
+}
+
+static inline u64_t xBufSerGetBE(bufser_t * psS, int Len) {
+	const u8_t * pu8 = pBufSerTake(psS, Len);
+	u64_t Val = 0;
+	if (pu8) {
+		for (int i = 0; i < Len; ++i)
+			Val = (Val << 8) | pu8[i];
+	}
+	return Val;
+}
+
+static inline u16_t xBufSerGetU16LE(bufser_t * psS) { return xBufSerGetLE(psS, sizeof(u16_t)); }
+static inline u16_t xBufSerGetU16BE(bufser_t * psS) { return xBufSerGetBE(psS, sizeof(u16_t)); }
+static inline u32_t xBufSerGetU32LE(bufser_t * psS) { return xBufSerGetLE(psS, sizeof(u32_t)); }
+static inline u32_t xBufSerGetU32BE(bufser_t * psS) { return xBufSerGetBE(psS, sizeof(u32_t)); }
+static inline u64_t xBufSerGetU64LE(bufser_t * psS) { return xBufSerGetLE(psS, sizeof(u64_t)); }
+static inline u64_t xBufSerGetU64BE(bufser_t * psS) { return xBufSerGetBE(psS, sizeof(u64_t)); }
+
+static inline u64_t xBufSerGetVar(bufser_t * psS) {
+	u64_t Val = 0;
+	for (int i = 0; i < bufserVAR_MAX; ++i) {
+		const u8_t * pu8 = pBufSerTake(psS, 1);
+		if (pu8 == NULL)
+			return 0;
+		Val |= (u64_t) (*pu8 & 0x7F) << (7 * i);
+		if ((*pu8 & 0x80) == 0)
+			return Val;
+	}
+	psS->f_err = 1;									// too long, malformed
+	return 0;
+}
+
+static inline i64_t xBufSerGetVarS(bufser_t * psS) {
+	u64_t Val = xBufSerGetVar(psS);
+	return (i64_t) (Val >> 1) ^ -(i64_t) (Val & 1);
+}
+
+static inline bool bBufSerGetBlob(bufser_t * psS, void * pvBuf, size_t Len) {
+	const u8_t * pu8 = pBufSerTake(psS, Len);
+	if (pu8)
+		memcpy(pvBuf, pu8, Len);
+	return pu8 != NULL;
+}
+
+/**
+ * @brief		get a length prefixed string without copying it
+ * @param[out]	pLen - string length
+ * @return		pointer to the (NOT terminated) string inside the buffer, NULL if error
+ */
+static inline const char * pcBufSerGetStr(bufser_t * psS, size_t * pLen) {
+	u64_t Len = xBufSerGetVar(psS);
+	if (Len > (u64_t) (psS->pLim - psS->pNow))		// before narrowing, a huge u64 could wrap
+		psS->f_err = 1;
+	const u8_t * pu8 = psS->f_err ? NULL : pBufSerTake(psS, (size_t) Len);
+	*pLen = pu8 ? (size_t) Len : 0;
+	return (const char *) pu8;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,123 @@
+// x_hlog.c - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+#include "hal_platform.h"
+#include "x_hlog.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define	debugFLAG					0xF000
+
+#define	debugTIMING					(debugFLAG_GLOBAL & debugFLAG & 0x1000)
+#define	debugTRACK					(debugFLAG_GLOBAL & debugFLAG & 0x2000)
+#define	debugPARAM					(debugFLAG_GLOBAL & debugFLAG & 0x4000)
+#define	debugRESULT					(debugFLAG_GLOBAL & debugFLAG & 0x8000)
+
+// ################################# Local/static functions ########################################
+
+/**
+ * @brief		load snapshot and replay appended records
+ * @return		erSUCCESS, erFAILURE if no valid log, or 1 if valid but the last record incomplete
+ */
+static int xHLogLoad(hlog_t * psL) {
+	int fd = open(psL->pccPath, O_RDONLY);
+	if ((fd < 0) && (errno == ENOENT)) {				// compaction interrupted between unlink and rename ?
+		char caTmp[hlogPATHMAX];
+		if ((snprintf(caTmp, sizeof(caTmp), "%s~", psL->pccPath) < sizeof(caTmp)) && (rename(caTmp, psL->pccPath) == 0))
+			fd = open(psL->pccPath, O_RDONLY);
+	}
+	if (fd < 0)
+		return erFAILURE;
+	int iRV = erFAILURE;
+	hlog_hdr_t sHdr;
+	if ((read(fd, &sHdr, sizeof(sHdr)) == sizeof(sHdr)) && (sHdr.Magic == psL->psOps->Magic) &&
+		(sHdr.Size == psL->Size) && (psL->psOps->load(psL->pvHist, fd) == erSUCCESS)) {
+		iRV = erSUCCESS;
+		u16_t Len;
+		ssize_t Got;
+		while ((Got = read(fd, &Len, sizeof(Len))) == sizeof(Len)) {
+			if (psL->psOps->replay(psL->pvHist, fd, Len) == erFAILURE)
+				break;
+			psL->Appended += sizeof(Len) + Len;
+		}
+		if (Got != 0)									// not a clean end of file
+			iRV = 1;
+	}
+	close(fd);
+	return iRV;
+}
+
+// ################################### Global/public functions #####################################
+
+int xHLogCompact(hlog_t * psL) {
+	char caTmp[hlogPATHMAX];
+	if (snprintf(caTmp, sizeof(caTmp), "%s~", psL->pccPath) >= sizeof(caTmp)) {
+		errno = ENAMETOOLONG;
+		return erFAILURE;
+	}
+	int fd = open(caTmp, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0)
+		return erFAILURE;								// log still open, appends continue
+	hlog_hdr_t sHdr = { .Magic = psL->psOps->Magic, .Size = psL->Size };
+	bool bOK = (write(fd, &sHdr, sizeof(sHdr)) == sizeof(sHdr)) &&
+				(psL->psOps->save(psL->pvHist, fd) == erSUCCESS);
+	if ((close(fd) < 0) || !bOK) {
+		unlink(caTmp);
+		return erFAILURE;
+	}
+	if (psL->fd >= 0) {									// not every file system replaces an open file
+		close(psL->fd);
+		psL->fd = -1;
+	}
+	int iRV = erSUCCESS;
+	if (rename(caTmp, psL->pccPath) < 0) {				// atomic where supported
+		unlink(psL->pccPath);							// some file systems do not rename over
+		if (rename(caTmp, psL->pccPath) < 0)
+			iRV = erFAILURE;							// xHLogLoad() recovers "path~"
+	}
+	// new log, or the old one if not replaced. If neither opens the next append compacts again
+	psL->fd = open(psL->pccPath, O_WRONLY | O_APPEND);
+	if (psL->fd < 0)
+		return erFAILURE;
+	if (iRV == erSUCCESS)
+		psL->Appended = 0;
+	return iRV;
+}
+
+int xHLogOpen(hlog_t * psL, const hlog_ops_t * psOps, void * pvHist, u32_t Size, u32_t Limit, const char * pccPath) {
+	IF_myASSERT(debugPARAM, (psOps != NULL) && (pvHist != NULL) && (pccPath != NULL));
+	*psL = (hlog_t) { .pccPath = pccPath, .psOps = psOps, .pvHist = pvHist, .Size = Size, .Limit = Limit, .fd = -1 };
+	int iRV = xHLogLoad(psL);
+	if ((iRV != erSUCCESS) || (psL->Appended >= psL->Limit))
+		return xHLogCompact(psL);						// new, damaged or overdue
+	psL->fd = open(pccPath, O_WRONLY | O_APPEND);
+	return (psL->fd < 0) ? erFAILURE : erSUCCESS;
+}
+
+int xHLogAppend(hlog_t * psL, const void * pvRec, size_t Len) {
+	IF_myASSERT(debugPARAM, Len <= UINT16_MAX);
+	if ((psL->fd < 0) || (psL->Appended >= psL->Limit))
+		return xHLogCompact(psL);						// reopen by snapshot, already includes this entry
+	u16_t u16Len = Len;
+	u8_t caRec[sizeof(u16Len) + 64];					// single write for typical entries
+	ssize_t Rec = sizeof(u16Len) + Len;
+	if (Rec <= sizeof(caRec)) {
+		memcpy(caRec, &u16Len, sizeof(u16Len));
+		memcpy(caRec + sizeof(u16Len), pvRec, Len);
+		if (write(psL->fd, caRec, Rec) != Rec)
+			return erFAILURE;
+	} else if ((write(psL->fd, &u16Len, sizeof(u16Len)) != sizeof(u16Len)) || (write(psL->fd, pvRec, Len) != Len)) {
+		return erFAILURE;
+	}
+	psL->Appended += Rec;
+	return erSUCCESS;
+}
+
+void vHLogClose(hlog_t * psL) {
+	if (psL->fd >= 0)
+		close(psL->fd);
+	psL->fd = -1;
+}
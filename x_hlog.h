@@ -0,0 +1,91 @@
+// x_hlog.h - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+/* Append-only history log, shared by hbuf_t and the f_history ubuf_t. A log file is a header, a
+ * raw image of the history (the snapshot) then one record per entry added since, each a u16_t
+ * length followed by the characters. Loading reads the image straight into the history and the
+ * records straight into its ring, adding an entry appends a single record. Once Limit record
+ * bytes have been appended the log is compacted: a new snapshot is written to "path~" and renamed
+ * over the log. The owner supplies the image and record handling, see hlog_ops_t.
+ */
+
+#pragma	once
+
+#include "definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ##################################### MACRO definitions #########################################
+
+#define	hlogPATHMAX					64			// includes the suffix used during compaction
+
+// ####################################### structures  #############################################
+
+typedef struct __attribute__((packed)) hlog_hdr_t {
+	u32_t Magic;						// history type
+	u32_t Size;							// image size, layout check
+} hlog_hdr_t;
+
+typedef struct hlog_ops_t {
+	u32_t Magic;
+	int (* save)(void * pvHist, int fd);				// write image, erFAILURE if incomplete
+	int (* load)(void * pvHist, int fd);				// read image, erFAILURE if invalid
+	int (* replay)(void * pvHist, int fd, size_t Len);	// read record body into the history
+} hlog_ops_t;
+
+typedef struct hlog_t {
+	const char * pccPath;				// log file, must remain valid while open
+	const hlog_ops_t * psOps;
+	void * pvHist;						// history the log belongs to
+	u32_t Size;							// image size
+	u32_t Limit;						// appended record bytes that trigger compaction
+	u32_t Appended;						// record bytes following the snapshot
+	int fd;								// open for append
+} hlog_t;
+
+// ################################### EXTERNAL FUNCTIONS ##########################################
+
+/**
+ * @brief		load a history from its log file, creating it if absent or invalid, and keep it open
+ * @param[in]	psL - pointer to log control structure
+ * @param[in]	psOps - image and record handlers of the history type
+ * @param[in]	pvHist - history, contents replaced if the log loaded
+ * @param[in]	Size - image size, a log with another size is discarded
+ * @param[in]	Limit - appended record bytes that trigger compaction
+ * @param[in]	pccPath - log file path, shorter than hlogPATHMAX - 1
+ * @return		erSUCCESS or erFAILURE with errno set
+ * @note		a record cut short (power lost during append) is discarded and the log compacted
+ * @note		if only "path~" exists (power lost during compaction) it is renamed and used
+ */
+int xHLogOpen(hlog_t * psL, const hlog_ops_t * psOps, void * pvHist, u32_t Size, u32_t Limit, const char * pccPath);
+
+/**
+ * @brief		append a record for an entry already added to the history
+ * @param[in]	psL - pointer to log control structure
+ * @param[in]	pvRec - entry characters
+ * @param[in]	Len - number of characters, at most 65535
+ * @return		erSUCCESS or erFAILURE with errno set
+ * @note		compacts instead once Limit record bytes have been appended, or if the log is not
+ * 				open because an earlier compaction failed. The snapshot includes the entry.
+ */
+int xHLogAppend(hlog_t * psL, const void * pvRec, size_t Len);
+
+/**
+ * @brief		rewrite the log as a single snapshot of the current history
+ * @param[in]	psL - pointer to log control structure
+ * @return		erSUCCESS or erFAILURE with errno set
+ * @note		written to "path~" then renamed over the log. Where the file system does not rename
+ * 				over, the log is removed first and a later xHLogOpen() recovers "path~".
+ * @note		on failure the existing log, if any, is reopened for append
+ */
+int xHLogCompact(hlog_t * psL);
+
+/**
+ * @brief		close the log, the history itself is not affected
+ */
+void vHLogClose(hlog_t * psL);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,360 @@
+// x_mrbuf.c - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+#include "hal_platform.h"
+#include "x_mrbuf.h"
+
+#include "hal_memory.h"
+#include "hal_stdio.h"
+#include "report.h"
+#include "errors_events.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define	debugFLAG					0xF000
+
+#define	debugTIMING					(debugFLAG_GLOBAL & debugFLAG & 0x1000)
+#define	debugTRACK					(debugFLAG_GLOBAL & debugFLAG & 0x2000)
+#define	debugPARAM					(debugFLAG_GLOBAL & debugFLAG & 0x4000)
+#define	debugRESULT					(debugFLAG_GLOBAL & debugFLAG & 0x8000)
+
+// ################################# Local/static functions ########################################
+
+static void xMRBufLock(mrbuf_t * psMR) { xRtosSemaphoreTake(&psMR->mux, portMAX_DELAY); }
+
+static void xMRBufUnLock(mrbuf_t * psMR) { xRtosSemaphoreGive(&psMR->mux); }
+
+/**
+ * @brief		bytes held back by the slowest active (or busy) reader, buffer MUST be locked
+ */
+static u32_t xMRBufMaxUsed(mrbuf_t * psMR) {
+	u32_t Max = 0;
+	for (int i = 0; i < mrbufMAX_READERS; ++i) {
+		if ((psMR->sRdr[i].f_active || psMR->sRdr[i].f_busy) && ((psMR->WR - psMR->sRdr[i].RD) > Max))
+			Max = psMR->WR - psMR->sRdr[i].RD;
+	}
+	return Max;
+}
+
+/**
+ * @brief		move readers forward so that Size bytes can be written, buffer MUST be locked
+ * @return		total bytes skipped over all readers
+ */
+static u32_t xMRBufLap(mrbuf_t * psMR, size_t Size) {
+	u32_t Total = 0;
+	u32_t Min = psMR->WR + Size - psMR->Size;			// oldest byte that survives the write
+	for (int i = 0; i < mrbufMAX_READERS; ++i) {
+		mrbuf_rdr_t * psR = &psMR->sRdr[i];
+		if (psR->f_active && (i32_t) (Min - psR->RD) > 0) {
+			psR->Lost += Min - psR->RD;
+			Total += Min - psR->RD;
+			++psR->Lapped;
+			psR->f_lapped = 1;
+			psR->RD = Min;
+		}
+	}
+	return Total;
+}
+
+/**
+ * @brief		check if writing Size bytes would lap a span being handled, buffer MUST be locked
+ */
+static bool bMRBufPinned(mrbuf_t * psMR, size_t Size) {
+	u32_t Min = psMR->WR + Size - psMR->Size;
+	for (int i = 0; i < mrbufMAX_READERS; ++i) {
+		if (psMR->sRdr[i].f_busy && (i32_t) (Min - psMR->sRdr[i].RD) > 0)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * @brief		decide how much of a write that does not fit may go ahead, buffer MUST be locked
+ * @return		number of bytes to write or bufOVF_DROP, lock held on return
+ */
+static ssize_t xMRBufOverflow(mrbuf_t * psMR, size_t Size) {
+	bufovf_t * psO = psMR->psOvf;
+	int Policy = psO ? psO->Policy : bufPOLICY_DROPOLD;
+	ssize_t Avail = psMR->Size - xMRBufMaxUsed(psMR);
+	switch (Policy) {
+	case bufPOLICY_BLOCK: {
+		TickType_t tStart = xTaskGetTickCount();
+		while ((Avail = psMR->Size - xMRBufMaxUsed(psMR)) < Size) {
+			if ((xTaskGetTickCount() - tStart) >= pdMS_TO_TICKS(psO->msWait)) {
+				vBufOvfEvent(psO, psMR, bufOVF_TIMEOUT, Size, 0, Size);
+				errno = ETIMEDOUT;
+				return bufOVF_DROP;
+			}
+			xMRBufUnLock(psMR);							// let the readers catch up
+			vBufOvfDelay();
+			xMRBufLock(psMR);
+		}
+		vBufOvfEvent(psO, psMR, bufOVF_BLOCKED, Size, Size, 0);
+		return Size;
+	}
+	case bufPOLICY_DROPNEW:
+		vBufOvfEvent(psO, psMR, bufOVF_DROPNEW, Size, 0, Size);
+		errno = ENOSPC;
+		return bufOVF_DROP;
+
+	case bufPOLICY_PARTIAL:
+		vBufOvfEvent(psO, psMR, bufOVF_PARTIAL, Size, Avail, Size - Avail);
+		errno = EAGAIN;
+		return Avail;
+
+	default: {											// bufPOLICY_LEGACY & bufPOLICY_DROPOLD
+		while (bMRBufPinned(psMR, Size)) {				// never overwrite data being handled
+			xMRBufUnLock(psMR);
+			vBufOvfDelay();
+			xMRBufLock(psMR);
+		}
+		u32_t Lost = xMRBufLap(psMR, Size);
+		if (psO)
+			vBufOvfEvent(psO, psMR, bufOVF_DROPOLD, Size, Size, Lost);
+		return Size;
+	}
+	}
+}
+
+/**
+ * @brief		contiguous unread data of a reader, buffer MUST be locked
+ * @return		number of bytes at *ppu8 before the end of the buffer
+ */
+static size_t xMRBufSegment(mrbuf_t * psMR, mrbuf_rdr_t * psR, u8_t ** ppu8) {
+	u32_t Idx = psR->RD & (psMR->Size - 1);
+	size_t Now = psMR->Size - Idx;
+	if (Now > (psMR->WR - psR->RD))
+		Now = psMR->WR - psR->RD;
+	*ppu8 = psMR->pBuf + Idx;
+	return Now;
+}
+
+// ################################### Global/public functions #####################################
+
+mrbuf_t * psMRBufCreate(mrbuf_t * psMR, u8_t * pcBuf, size_t Size) {
+	IF_myASSERT(debugPARAM, (psMR == NULL) || halMemorySRAM(psMR));
+	IF_myASSERT(debugPARAM, (pcBuf == NULL) || halMemoryRAM(pcBuf));
+	IF_myASSERT(debugPARAM, (Size > 1) && ((Size & (Size - 1)) == 0));
+	bool bAlloc = (pcBuf == NULL);
+	if (bAlloc) {
+		pcBuf = pvBAllocType(NULL, ballocTYPE_MRBUF, Size, ballocCAP_DEFAULT);
+		if (pcBuf == NULL)
+			return NULL;
+	}
+	bool bStruct = (psMR == NULL);
+	if (bStruct) {
+		psMR = pvBAllocType(NULL, ballocTYPE_MRBUF, sizeof(mrbuf_t), ballocCAP_DEFAULT);
+		if (psMR == NULL) {
+			if (bAlloc)
+				vBFreeType(NULL, ballocTYPE_MRBUF, pcBuf, Size);
+			return NULL;
+		}
+	}
+	memset(psMR, 0, sizeof(mrbuf_t));
+	psMR->pBuf = pcBuf;
+	psMR->Size = Size;
+	psMR->f_alloc = bAlloc;
+	psMR->f_struct = bStruct;
+	return psMR;
+}
+
+void vMRBufDestroy(mrbuf_t * psMR) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psMR));
+	if (psMR->mux)
+		vRtosSemaphoreDelete(&psMR->mux);
+	if (psMR->f_alloc)
+		vBFreeType(NULL, ballocTYPE_MRBUF, psMR->pBuf, psMR->Size);
+	psMR->pBuf = NULL;
+	if (psMR->f_struct)
+		vBFreeType(NULL, ballocTYPE_MRBUF, psMR, sizeof(mrbuf_t));
+}
+
+int xMRBufAddReader(mrbuf_t * psMR, int (*hdlr)(const void *, size_t)) {
+	int iRV = erFAILURE;
+	xMRBufLock(psMR);
+	for (int i = 0; i < mrbufMAX_READERS; ++i) {
+		mrbuf_rdr_t * psR = &psMR->sRdr[i];
+		if ((psR->f_active == 0) && (psR->f_busy == 0)) {
+			*psR = (mrbuf_rdr_t) { .hdlr = hdlr, .RD = psMR->WR, .f_active = 1 };
+			iRV = i;
+			break;
+		}
+	}
+	xMRBufUnLock(psMR);
+	if (iRV == erFAILURE)
+		errno = ENFILE;
+	return iRV;
+}
+
+void vMRBufDelReader(mrbuf_t * psMR, int Rdr) {
+	IF_myASSERT(debugPARAM, INRANGE(0, Rdr, mrbufMAX_READERS - 1));
+	xMRBufLock(psMR);
+	psMR->sRdr[Rdr].f_active = 0;						// no longer holds back space
+	xMRBufUnLock(psMR);
+}
+
+void vMRBufSetPolicy(mrbuf_t * psMR, bufovf_t * psO) {
+	IF_myASSERT(debugPARAM, (psO == NULL) || (psO->Policy < bufPOLICY_NUMBER));
+	xMRBufLock(psMR);
+	psMR->psOvf = psO;
+	xMRBufUnLock(psMR);
+}
+
+ssize_t xMRBufWrite(mrbuf_t * psMR, const void * pvBuf, size_t Size) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psMR) && (pvBuf != NULL));
+	if (Size > psMR->Size) {
+		errno = EINVAL;
+		return erFAILURE;
+	}
+	xMRBufLock(psMR);
+	ssize_t Now = Size;
+	if ((psMR->Size - xMRBufMaxUsed(psMR)) < Size)
+		Now = xMRBufOverflow(psMR, Size);
+	if (Now > 0) {
+		u32_t Idx = psMR->WR & (psMR->Size - 1);
+		size_t Seg = psMR->Size - Idx;
+		if (Seg > Now)
+			Seg = Now;
+		memcpy(psMR->pBuf + Idx, pvBuf, Seg);
+		memcpy(psMR->pBuf, (const u8_t *) pvBuf + Seg, Now - Seg);
+		psMR->WR += Now;
+	}
+	xMRBufUnLock(psMR);
+	return (Now == bufOVF_DROP) ? 0 : Now;				// dropped, errno set
+}
+
+size_t xMRBufGetUsed(mrbuf_t * psMR, int Rdr) {
+	IF_myASSERT(debugPARAM, INRANGE(0, Rdr, mrbufMAX_READERS - 1));
+	xMRBufLock(psMR);
+	size_t Used = psMR->WR - psMR->sRdr[Rdr].RD;
+	xMRBufUnLock(psMR);
+	return Used;
+}
+
+size_t xMRBufGetSpace(mrbuf_t * psMR) {
+	xMRBufLock(psMR);
+	size_t Space = psMR->Size - xMRBufMaxUsed(psMR);
+	xMRBufUnLock(psMR);
+	return Space;
+}
+
+ssize_t xMRBufRead(mrbuf_t * psMR, int Rdr, void * pvBuf, size_t Size) {
+	IF_myASSERT(debugPARAM, INRANGE(0, Rdr, mrbufMAX_READERS - 1) && (pvBuf != NULL));
+	mrbuf_rdr_t * psR = &psMR->sRdr[Rdr];
+	ssize_t sRV = 0;
+	xMRBufLock(psMR);
+	while ((sRV < Size) && (psMR->WR != psR->RD)) {	// at most 2 segments
+		u8_t * pu8;
+		size_t Now = xMRBufSegment(psMR, psR, &pu8);
+		if (Now > (Size - sRV))
+			Now = Size - sRV;
+		memcpy((u8_t *) pvBuf + sRV, pu8, Now);
+		psR->RD += Now;
+		sRV += Now;
+	}
+	xMRBufUnLock(psMR);
+	return sRV;
+}
+
+int xMRBufEmptyLimit(mrbuf_t * psMR, int Rdr, size_t Max) {
+	IF_myASSERT(debugPARAM, INRANGE(0, Rdr, mrbufMAX_READERS - 1) && (psMR->sRdr[Rdr].hdlr != NULL));
+	mrbuf_rdr_t * psR = &psMR->sRdr[Rdr];
+	int iRV = 0;
+	size_t Total = 0;
+	xMRBufLock(psMR);
+	if (psR->f_busy) {									// another task draining this reader
+		xMRBufUnLock(psMR);
+		errno = EBUSY;
+		return erFAILURE;
+	}
+	if (Max == 0)
+		Max = psMR->WR - psR->RD;
+	while ((Total < Max) && (psMR->WR != psR->RD)) {
+		u8_t * pu8;
+		size_t Now = xMRBufSegment(psMR, psR, &pu8);
+		if (Now > (Max - Total))
+			Now = Max - Total;
+		int (*hdlr)(const void *, size_t) = psR->hdlr;
+		u32_t RD = psR->RD;
+		psR->f_busy = 1;								// pin span, RD cannot move until cleared
+		xMRBufUnLock(psMR);
+		iRV = hdlr(pu8, Now);							// sink latency, buffer NOT locked
+		xMRBufLock(psMR);
+		psR->f_busy = 0;
+		if (iRV <= 0)
+			break;
+		psR->RD = RD + iRV;								// advance by what was ACCEPTED
+		Total += iRV;
+		if (iRV < Now)									// sink full, try again later
+			break;
+	}
+	xMRBufUnLock(psMR);
+	return (iRV < erSUCCESS) ? iRV : Total;
+}
+
+int xMRBufEmptyBlock(mrbuf_t * psMR, int Rdr) { return xMRBufEmptyLimit(psMR, Rdr, 0); }
+
+int xMRBufEmptyAll(mrbuf_t * psMR) {
+	int iRV = 0;
+	for (int i = 0; i < mrbufMAX_READERS; ++i) {
+		if (psMR->sRdr[i].f_active && psMR->sRdr[i].hdlr) {
+			int iNow = xMRBufEmptyLimit(psMR, i, 0);
+			if (iNow > 0)
+				iRV += iNow;
+		}
+	}
+	return iRV;
+}
+
+bool bMRBufLapped(mrbuf_t * psMR, int Rdr) {
+	IF_myASSERT(debugPARAM, INRANGE(0, Rdr, mrbufMAX_READERS - 1));
+	xMRBufLock(psMR);
+	bool bRV = psMR->sRdr[Rdr].f_lapped;
+	psMR->sRdr[Rdr].f_lapped = 0;
+	xMRBufUnLock(psMR);
+	return bRV;
+}
+
+int xMRBufReport(report_t * psR, mrbuf_t * psMR) {
+	int iRV = xReport(psR, "P=%p  Sz=%lu  WR=%lu  mux=%p" strNL, psMR->pBuf, psMR->Size, psMR->WR, psMR->mux);
+	for (int i = 0; i < mrbufMAX_READERS; ++i) {
+		mrbuf_rdr_t * psRdr = &psMR->sRdr[i];
+		if (psRdr->f_active)
+			iRV += xReport(psR, "  #%d  U=%lu  Lost=%lu  Lapped=%u%s" strNL, i, psMR->WR - psRdr->RD,
+					psRdr->Lost, psRdr->Lapped, psRdr->f_lapped ? "  (lapped)" : "");
+	}
+	return iRV;
+}
+
+// ################################## Diagnostic and testing functions #############################
+
+static size_t MRBufTestSunk;
+
+static int xMRBufTestSink(const void * pvBuf, size_t Len) {
+	MRBufTestSunk += Len;
+	return Len;
+}
+
+void vMRBufTest(void) {
+	u8_t caBuf[64];
+	mrbuf_t * psMR = psMRBufCreate(NULL, NULL, 64);
+	if (psMR == NULL) {
+		PX("Failed create" strNL);
+		return;
+	}
+	int Fast = xMRBufAddReader(psMR, xMRBufTestSink), Slow = xMRBufAddReader(psMR, NULL);
+	MRBufTestSunk = 0;
+	// each reader sees every byte once, independent of the other
+	memset(caBuf, CHR_a, sizeof(caBuf));
+	if (xMRBufWrite(psMR, caBuf, 40) != 40)										PX("Failed write" strNL);
+	if ((xMRBufEmptyBlock(psMR, Fast) != 40) || (MRBufTestSunk != 40))			PX("Failed drain" strNL);
+	if ((xMRBufGetUsed(psMR, Fast) != 0) || (xMRBufGetUsed(psMR, Slow) != 40))	PX("Failed cursors" strNL);
+	// no policy: slowest reader lapped, oldest skipped and counted
+	memset(caBuf, CHR_A, sizeof(caBuf));
+	if (xMRBufWrite(psMR, caBuf, 40) != 40)										PX("Failed lap write" strNL);
+	if (!bMRBufLapped(psMR, Slow) || (psMR->sRdr[Slow].Lost != 16))				PX("Failed lapped" strNL);
+	if (xMRBufRead(psMR, Slow, caBuf, sizeof(caBuf)) != 64)						PX("Failed lap read" strNL);
+	if ((caBuf[23] != CHR_a) || (caBuf[24] != CHR_A))							PX("Failed lap data" strNL);
+	if (bMRBufLapped(psMR, Fast) || (xMRBufEmptyAll(psMR) != 40))				PX("Failed fast" strNL);
+	vMRBufDestroy(psMR);
+}
@@ -0,0 +1,133 @@
+// x_mrbuf.h - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+/* Multi reader (fan out) ring: one writer appends once, each registered reader has its own read
+ * cursor and optional drain handler. Space is reclaimed at the slowest active reader. If a write
+ * does not fit the attached bufovf_t policy decides, default (no policy) is to lap the slowest
+ * reader(s), skipping their oldest unread data, count the bytes lost and flag them.
+ *
+ * WR and each RD are free running byte counts, Size MUST be a power of 2.
+ */
+
+#pragma	once
+
+#include "definitions.h"
+#include "FreeRTOS_Support.h"
+#include "x_balloc.h"
+#include "x_bufovf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ##################################### MACRO definitions #########################################
+
+#define	mrbufMAX_READERS			4
+
+// ####################################### structures  #############################################
+
+typedef struct mrbuf_rdr_t {
+	int (*hdlr)(const void *, size_t);	// drain handler, NULL if only read with xMRBufRead()
+	u32_t RD;						// free running count of bytes read
+	u32_t Lost;						// bytes skipped while lapped
+	u16_t Lapped;					// number of times lapped
+	u8_t f_active:1;
+	u8_t f_lapped:1;				// lapped since last checked
+	u8_t f_busy:1;					// handler running unlocked, span from RD pinned
+	u8_t f_spare:5;
+} mrbuf_rdr_t;
+
+typedef struct mrbuf_t {
+	u8_t * pBuf;
+	SemaphoreHandle_t mux;
+	bufovf_t * psOvf;				// optional overflow policy, NULL = lap slowest reader
+	u32_t WR;						// free running count of bytes written
+	u32_t Size;						// power of 2
+	mrbuf_rdr_t sRdr[mrbufMAX_READERS];
+	u8_t f_alloc:1;					// buffer allocated
+	u8_t f_struct:1;				// struct allocated
+	u8_t f_spare:6;
+} mrbuf_t;
+
+// ################################### EXTERNAL FUNCTIONS ##########################################
+
+/**
+ * @brief		create/initialise a multi reader ring
+ * @param[in]	psMR - pointer to control structure, NULL to allocate
+ * @param[in]	pcBuf - pointer to buffer, NULL to allocate
+ * @param[in]	Size - buffer size, power of 2
+ * @return		pointer to control structure or NULL if allocation failed
+ */
+mrbuf_t * psMRBufCreate(mrbuf_t * psMR, u8_t * pcBuf, size_t Size);
+
+void vMRBufDestroy(mrbuf_t * psMR);
+
+/**
+ * @brief		register a reader, it only sees data written from now on
+ * @param[in]	psMR - pointer to control structure
+ * @param[in]	hdlr - drain handler used by xMRBufEmpty???(), can be NULL
+ * @return		reader number or erFAILURE with errno set if no free slot
+ */
+int xMRBufAddReader(mrbuf_t * psMR, int (*hdlr)(const void *, size_t));
+
+/**
+ * @brief		unregister a reader, it no longer holds back space
+ */
+void vMRBufDelReader(mrbuf_t * psMR, int Rdr);
+
+/**
+ * @brief		attach an overflow policy, NULL to revert to lapping the slowest reader
+ * @note		bufPOLICY_DROPOLD and bufPOLICY_LEGACY lap, other policies as for ubuf_t
+ */
+void vMRBufSetPolicy(mrbuf_t * psMR, bufovf_t * psO);
+
+/**
+ * @brief		append data once for all readers
+ * @return		number of bytes accepted, 0 with errno set if dropped by policy, or erFAILURE
+ */
+ssize_t xMRBufWrite(mrbuf_t * psMR, const void * pvBuf, size_t Size);
+
+/**
+ * @brief		number of unread bytes for a reader
+ */
+size_t xMRBufGetUsed(mrbuf_t * psMR, int Rdr);
+
+/**
+ * @brief		bytes that can be written without lapping or blocking
+ */
+size_t xMRBufGetSpace(mrbuf_t * psMR);
+
+/**
+ * @brief		copy and consume unread data for a reader
+ * @return		number of bytes read, 0 if none available
+ */
+ssize_t xMRBufRead(mrbuf_t * psMR, int Rdr, void * pvBuf, size_t Size);
+
+/**
+ * @brief		drain up to Max bytes for a reader to its handler, advance by what was accepted
+ * @param[in]	Max - maximum bytes, 0 = everything buffered now
+ * @return		number of bytes drained, handler error or erFAILURE (EBUSY) if already being drained
+ * @note		the handler is called WITHOUT the lock held, writers only wait for it if they
+ * 				would have to lap the span being handled
+ */
+int xMRBufEmptyLimit(mrbuf_t * psMR, int Rdr, size_t Max);
+
+int xMRBufEmptyBlock(mrbuf_t * psMR, int Rdr);
+
+/**
+ * @brief		drain all active readers that have a handler
+ * @return		total number of bytes drained
+ */
+int xMRBufEmptyAll(mrbuf_t * psMR);
+
+/**
+ * @brief		check and clear the lapped flag of a reader
+ * @return		true if lapped (data lost) since last checked
+ */
+bool bMRBufLapped(mrbuf_t * psMR, int Rdr);
+
+struct report_t;
+int xMRBufReport(struct report_t * psR, mrbuf_t * psMR);
+
+#ifdef __cplusplus
+}
+#endif
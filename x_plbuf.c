@@ -0,0 +1,327 @@
+// x_plbuf.c - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+#include "hal_platform.h"
+#include "x_plbuf.h"
+
+#include "hal_memory.h"
+#include "hal_stdio.h"
+#include "report.h"
+#include "errors_events.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define	debugFLAG					0xF000
+
+#define	debugTIMING					(debugFLAG_GLOBAL & debugFLAG & 0x1000)
+#define	debugTRACK					(debugFLAG_GLOBAL & debugFLAG & 0x2000)
+#define	debugPARAM					(debugFLAG_GLOBAL & debugFLAG & 0x4000)
+#define	debugRESULT					(debugFLAG_GLOBAL & debugFLAG & 0x8000)
+
+// ################################# Local/static functions ########################################
+
+static void xPLBufLock(plbuf_t * psPL) { xRtosSemaphoreTake(&psPL->mux, portMAX_DELAY); }
+
+static void xPLBufUnLock(plbuf_t * psPL) { xRtosSemaphoreGive(&psPL->mux); }
+
+/**
+ * @brief		return the oldest block of a lane to the free list, buffer MUST be locked
+ */
+static void vPLBufPopHead(plbuf_t * psPL, plbuf_lane_t * psL) {
+	u16_t Blk = psL->Head;
+	psL->Head = psPL->pNext[Blk];
+	if (psL->Head == plbufNONE)
+		psL->Tail = plbufNONE;
+	psPL->pNext[Blk] = psPL->Free;
+	psPL->Free = Blk;
+	++psPL->NumFree;
+	--psL->Blocks;
+	psL->OffRD = 0;
+}
+
+/**
+ * @brief		unread bytes in the oldest block of a lane
+ */
+static size_t xPLBufHeadUsed(plbuf_lane_t * psL) {
+	return ((psL->Head == psL->Tail) ? psL->OffWR : plbufBLOCK_SIZE) - psL->OffRD;
+}
+
+/**
+ * @brief		blocks of lane l that a write to Lane may evict, buffer MUST be locked
+ */
+static size_t xPLBufEvictable(plbuf_t * psPL, int l, int Lane) {
+	plbuf_lane_t * psL = &psPL->sLane[l];
+	int Count = psL->Blocks;
+	if ((Count > 0) && (psL->Head == psPL->Pinned))
+		--Count;										// oldest being drained, not evicted
+	if (l == Lane)
+		--Count;										// own Tail is being written, not evicted
+	return (Count > 0) ? Count : 0;
+}
+
+/**
+ * @brief		free one block, taken from the lowest lane that may be evicted by a write to Lane
+ * @note		caller has verified that such a block exists
+ * @note		if the oldest block is pinned the one following it is dropped instead
+ */
+static void vPLBufEvict(plbuf_t * psPL, int Lane) {
+	for (int l = 0; l <= Lane; ++l) {
+		plbuf_lane_t * psL = &psPL->sLane[l];
+		if (xPLBufEvictable(psPL, l, Lane) == 0)
+			continue;
+		size_t Lost;
+		if (psL->Head != psPL->Pinned) {
+			Lost = xPLBufHeadUsed(psL);
+			vPLBufPopHead(psPL, psL);
+		} else {
+			u16_t Blk = psPL->pNext[psL->Head];			// never own Tail, see xPLBufEvictable()
+			psPL->pNext[psL->Head] = psPL->pNext[Blk];
+			if (Blk == psL->Tail) {						// pinned block (full) becomes the Tail
+				Lost = psL->OffWR;
+				psL->Tail = psL->Head;
+				psL->OffWR = plbufBLOCK_SIZE;
+			} else {
+				Lost = plbufBLOCK_SIZE;
+			}
+			psPL->pNext[Blk] = psPL->Free;
+			psPL->Free = Blk;
+			++psPL->NumFree;
+			--psL->Blocks;
+		}
+		psL->Used -= Lost;
+		psL->Lost += Lost;
+		return;
+	}
+}
+
+/**
+ * @brief		consume Step bytes from the oldest block of a lane, buffer MUST be locked
+ */
+static void vPLBufStep(plbuf_t * psPL, plbuf_lane_t * psL, size_t Step) {
+	psL->OffRD += Step;
+	psL->Used -= Step;
+	if ((psL->Used == 0) || ((psL->Head != psL->Tail) && (psL->OffRD == plbufBLOCK_SIZE)))
+		vPLBufPopHead(psPL, psL);						// block (or lane) done
+}
+
+/**
+ * @brief		highest non-empty lane, buffer MUST be locked
+ * @return		pointer to lane or NULL if all empty
+ */
+static plbuf_lane_t * psPLBufTop(plbuf_t * psPL) {
+	for (int l = psPL->Lanes - 1; l >= 0; --l) {
+		if (psPL->sLane[l].Used)
+			return &psPL->sLane[l];
+	}
+	return NULL;
+}
+
+// ################################### Global/public functions #####################################
+
+plbuf_t * psPLBufCreate(plbuf_t * psPL, size_t Size, int Lanes, const balloc_t * psA) {
+	IF_myASSERT(debugPARAM, (psPL == NULL) || halMemorySRAM(psPL));
+	IF_myASSERT(debugPARAM, INRANGE(1, Lanes, plbufMAX_LANES));
+	size_t Blocks = Size / plbufBLOCK_SIZE;
+	if ((Blocks < 2) || (Blocks >= plbufNONE)) {
+		errno = EINVAL;
+		return NULL;
+	}
+	size_t Alloc = Blocks * (plbufBLOCK_SIZE + sizeof(u16_t));
+	u8_t * pBuf = pvBAllocType(psA, ballocTYPE_PLBUF, Alloc, ballocALIGN(sizeof(u16_t)));
+	if (pBuf == NULL)
+		return NULL;
+	bool bStruct = (psPL == NULL);
+	if (bStruct) {
+		psPL = pvBAllocType(psA, ballocTYPE_PLBUF, sizeof(plbuf_t), ballocCAP_DEFAULT);
+		if (psPL == NULL) {
+			vBFreeType(psA, ballocTYPE_PLBUF, pBuf, Alloc);
+			return NULL;
+		}
+	}
+	memset(psPL, 0, sizeof(plbuf_t));
+	psPL->pBuf = pBuf;
+	psPL->pNext = (u16_t *) (pBuf + (Blocks * plbufBLOCK_SIZE));
+	psPL->psA = psA;
+	psPL->Blocks = psPL->NumFree = Blocks;
+	psPL->Pinned = plbufNONE;
+	psPL->Lanes = Lanes;
+	psPL->f_struct = bStruct;
+	for (int i = 0; i < Blocks; ++i)					// all blocks on the free list
+		psPL->pNext[i] = (i + 1 < Blocks) ? (i + 1) : plbufNONE;
+	for (int l = 0; l < plbufMAX_LANES; ++l)
+		psPL->sLane[l].Head = psPL->sLane[l].Tail = plbufNONE;
+	return psPL;
+}
+
+void vPLBufDestroy(plbuf_t * psPL) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psPL));
+	if (psPL->mux)
+		vRtosSemaphoreDelete(&psPL->mux);
+	vBFreeType(psPL->psA, ballocTYPE_PLBUF, psPL->pBuf, psPL->Blocks * (plbufBLOCK_SIZE + sizeof(u16_t)));
+	psPL->pBuf = NULL;
+	if (psPL->f_struct)
+		vBFreeType(psPL->psA, ballocTYPE_PLBUF, psPL, sizeof(plbuf_t));
+}
+
+ssize_t xPLBufWrite(plbuf_t * psPL, int Lane, const void * pvBuf, size_t Size) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psPL) && (pvBuf != NULL));
+	if (Lane < 0 || Lane >= psPL->Lanes) {
+		errno = EINVAL;
+		return erFAILURE;
+	}
+	plbuf_lane_t * psL = &psPL->sLane[Lane];
+	const u8_t * pu8 = pvBuf;
+	xPLBufLock(psPL);
+	// blocks needed beyond the room left in the Tail vs blocks free or evictable for this lane
+	size_t Room = (psL->Tail != plbufNONE) ? (plbufBLOCK_SIZE - psL->OffWR) : 0;
+	size_t Need = (Size > Room) ? ((Size - Room + plbufBLOCK_SIZE - 1) / plbufBLOCK_SIZE) : 0;
+	size_t Avail = psPL->NumFree;
+	for (int l = 0; l <= Lane; ++l)
+		Avail += xPLBufEvictable(psPL, l, Lane);
+	if (Need > Avail) {									// would evict higher priority data
+		psL->Lost += Size;
+		xPLBufUnLock(psPL);
+		errno = ENOSPC;
+		return 0;										// dropped, as xMRBufWrite()
+	}
+	size_t Left = Size;
+	while (Left) {
+		if ((psL->Tail == plbufNONE) || (psL->OffWR == plbufBLOCK_SIZE)) {
+			if (psPL->NumFree == 0)
+				vPLBufEvict(psPL, Lane);
+			u16_t Blk = psPL->Free;
+			psPL->Free = psPL->pNext[Blk];
+			--psPL->NumFree;
+			psPL->pNext[Blk] = plbufNONE;
+			if (psL->Tail == plbufNONE) {
+				psL->Head = Blk;
+				psL->OffRD = 0;
+			} else {
+				psPL->pNext[psL->Tail] = Blk;
+			}
+			psL->Tail = Blk;
+			psL->OffWR = 0;
+			++psL->Blocks;
+		}
+		size_t Now = plbufBLOCK_SIZE - psL->OffWR;
+		if (Now > Left)
+			Now = Left;
+		memcpy(psPL->pBuf + (psL->Tail * plbufBLOCK_SIZE) + psL->OffWR, pu8, Now);
+		psL->OffWR += Now;
+		psL->Used += Now;
+		pu8 += Now;
+		Left -= Now;
+	}
+	xPLBufUnLock(psPL);
+	return Size;
+}
+
+size_t xPLBufGetUsed(plbuf_t * psPL, int Lane) {
+	size_t Used = 0;
+	xPLBufLock(psPL);
+	for (int l = 0; l < psPL->Lanes; ++l) {
+		if ((Lane < 0) || (Lane == l))
+			Used += psPL->sLane[l].Used;
+	}
+	xPLBufUnLock(psPL);
+	return Used;
+}
+
+ssize_t xPLBufRead(plbuf_t * psPL, void * pvBuf, size_t Size) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psPL) && (pvBuf != NULL));
+	ssize_t sRV = 0;
+	plbuf_lane_t * psL;
+	xPLBufLock(psPL);
+	if (psPL->Pinned != plbufNONE) {					// single consumer, drain in progress
+		xPLBufUnLock(psPL);
+		errno = EBUSY;
+		return erFAILURE;
+	}
+	while ((sRV < Size) && (psL = psPLBufTop(psPL)) != NULL) {
+		size_t Now = xPLBufHeadUsed(psL);
+		if (Now > (Size - sRV))
+			Now = Size - sRV;
+		memcpy((u8_t *) pvBuf + sRV, psPL->pBuf + (psL->Head * plbufBLOCK_SIZE) + psL->OffRD, Now);
+		vPLBufStep(psPL, psL, Now);
+		sRV += Now;
+	}
+	xPLBufUnLock(psPL);
+	return sRV;
+}
+
+int xPLBufEmptyLimit(plbuf_t * psPL, int (*hdlr)(const void *, size_t), size_t Max) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psPL) && (hdlr != NULL));
+	int iRV = 0;
+	size_t Total = 0;
+	plbuf_lane_t * psL;
+	xPLBufLock(psPL);
+	if (psPL->Pinned != plbufNONE) {					// another task draining
+		xPLBufUnLock(psPL);
+		errno = EBUSY;
+		return erFAILURE;
+	}
+	if (Max == 0) {
+		for (int l = 0; l < psPL->Lanes; ++l)
+			Max += psPL->sLane[l].Used;
+	}
+	while ((Total < Max) && (psL = psPLBufTop(psPL)) != NULL) {
+		size_t Now = xPLBufHeadUsed(psL);
+		if (Now > (Max - Total))
+			Now = Max - Total;
+		u8_t * pu8 = psPL->pBuf + (psL->Head * plbufBLOCK_SIZE) + psL->OffRD;
+		psPL->Pinned = psL->Head;						// neither evicted nor read until cleared
+		xPLBufUnLock(psPL);
+		iRV = hdlr(pu8, Now);							// sink latency, buffer NOT locked
+		xPLBufLock(psPL);
+		psPL->Pinned = plbufNONE;
+		if (iRV <= 0)
+			break;
+		vPLBufStep(psPL, psL, iRV);						// advance by what was ACCEPTED
+		Total += iRV;
+		if (iRV < Now)									// sink full, try again later
+			break;
+	}
+	xPLBufUnLock(psPL);
+	return (iRV < erSUCCESS) ? iRV : Total;
+}
+
+int xPLBufEmptyBlock(plbuf_t * psPL, int (*hdlr)(const void *, size_t)) {
+	return xPLBufEmptyLimit(psPL, hdlr, 0);
+}
+
+int xPLBufReport(report_t * psR, plbuf_t * psPL) {
+	int iRV = xReport(psR, "P=%p  Blk=%u/%u  Free=%u  mux=%p" strNL, psPL->pBuf, psPL->Blocks,
+			plbufBLOCK_SIZE, psPL->NumFree, psPL->mux);
+	for (int l = psPL->Lanes - 1; l >= 0; --l) {
+		plbuf_lane_t * psL = &psPL->sLane[l];
+		iRV += xReport(psR, "  L%d  U=%lu  Blk=%u  Lost=%lu" strNL, l, psL->Used, psL->Blocks, psL->Lost);
+	}
+	return iRV;
+}
+
+// ################################## Diagnostic and testing functions #############################
+
+void vPLBufTest(void) {
+	u8_t caBuf[plbufBLOCK_SIZE];
+	plbuf_t * psPL = psPLBufCreate(NULL, 4 * plbufBLOCK_SIZE, 2, NULL);
+	if (psPL == NULL) {
+		PX("Failed create" strNL);
+		return;
+	}
+	// high lane read first, low lane evicted to make space for it
+	memset(caBuf, CHR_a, sizeof(caBuf));
+	for (int i = 0; i < 4; ++i)
+		xPLBufWrite(psPL, 0, caBuf, sizeof(caBuf));
+	memset(caBuf, CHR_A, sizeof(caBuf));
+	if (xPLBufWrite(psPL, 1, caBuf, 10) != 10)									PX("Failed high write" strNL);
+	if (psPL->sLane[0].Lost != plbufBLOCK_SIZE)									PX("Failed evict" strNL);
+	if (xPLBufRead(psPL, caBuf, 12) != 12)										PX("Failed read" strNL);
+	if ((caBuf[9] != CHR_A) || (caBuf[10] != CHR_a))							PX("Failed order" strNL);
+	// low lane never evicts the high lane, write dropped
+	for (int i = 0; i < 4; ++i)
+		xPLBufWrite(psPL, 1, caBuf, sizeof(caBuf));
+	errno = 0;
+	if ((xPLBufWrite(psPL, 0, caBuf, 1) != 0) || (errno != ENOSPC))			PX("Failed drop" strNL);
+	if (xPLBufGetUsed(psPL, 1) != 4 * plbufBLOCK_SIZE)							PX("Failed high kept" strNL);
+	vPLBufDestroy(psPL);
+}
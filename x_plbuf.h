@@ -0,0 +1,107 @@
+// x_plbuf.h - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+/* Priority lane buffer: up to plbufMAX_LANES FIFO lanes sharing one pool of fixed size blocks.
+ * Lane 0 is the lowest priority. Draining always serves the highest non-empty lane first. If a
+ * write does not fit, whole blocks are evicted from the lowest non-empty lane first, never from
+ * a lane of higher priority than the one written to; a write that still does not fit is dropped
+ * and counted against its lane. The drain handler runs with the buffer unlocked, the block it is
+ * handling is pinned: neither read nor evicted, a write needing space drops the block after it.
+ */
+
+#pragma	once
+
+#include "definitions.h"
+#include "FreeRTOS_Support.h"
+#include "x_balloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ##################################### MACRO definitions #########################################
+
+#define	plbufMAX_LANES				4
+#define	plbufNONE					0xFFFF		// end of block list
+
+// ###################################### BUILD : CONFIG definitions ###############################
+
+#ifndef plbufBLOCK_SIZE
+	#define	plbufBLOCK_SIZE			64			// eviction granularity, bytes
+#endif
+
+// ####################################### structures  #############################################
+
+typedef struct plbuf_lane_t {
+	u16_t Head;						// oldest block, plbufNONE if empty
+	u16_t Tail;						// newest block, being written
+	u16_t OffRD;					// offset of next byte to read in Head
+	u16_t OffWR;					// offset of next byte to write in Tail
+	u16_t Blocks;					// number of blocks in lane
+	u32_t Used;						// bytes unread
+	u32_t Lost;						// bytes evicted or dropped
+} plbuf_lane_t;
+
+typedef struct plbuf_t {
+	u8_t * pBuf;					// Blocks * plbufBLOCK_SIZE bytes
+	u16_t * pNext;					// next block in the same lane or in the free list
+	SemaphoreHandle_t mux;
+	const balloc_t * psA;
+	u16_t Blocks;					// total number of blocks
+	u16_t Free;						// first free block
+	u16_t NumFree;
+	u16_t Pinned;					// block being drained unlocked, plbufNONE if none
+	u8_t Lanes;						// number of lanes in use
+	u8_t f_struct:1;
+	u8_t f_spare:7;
+	plbuf_lane_t sLane[plbufMAX_LANES];
+} plbuf_t;
+
+// ################################### EXTERNAL FUNCTIONS ##########################################
+
+/**
+ * @brief		create a priority lane buffer
+ * @param[in]	psPL - pointer to control structure, NULL to allocate
+ * @param[in]	Size - total storage, rounded down to a multiple of plbufBLOCK_SIZE, at least 2 blocks
+ * @param[in]	Lanes - number of lanes, 1 to plbufMAX_LANES
+ * @param[in]	psA - allocator for storage, NULL for default
+ * @return		pointer to control structure or NULL if allocation failed
+ */
+plbuf_t * psPLBufCreate(plbuf_t * psPL, size_t Size, int Lanes, const balloc_t * psA);
+
+void vPLBufDestroy(plbuf_t * psPL);
+
+/**
+ * @brief		append data to a lane, evicting lower (or same) lane data if required
+ * @return		Size, 0 with errno ENOSPC if dropped (counted in the lane Lost), or erFAILURE if invalid
+ */
+ssize_t xPLBufWrite(plbuf_t * psPL, int Lane, const void * pvBuf, size_t Size);
+
+/**
+ * @brief		number of unread bytes in a lane, or all lanes if Lane is -1
+ */
+size_t xPLBufGetUsed(plbuf_t * psPL, int Lane);
+
+/**
+ * @brief		read and consume data, highest lane first
+ * @return		number of bytes read, or erFAILURE (EBUSY) while being drained
+ */
+ssize_t xPLBufRead(plbuf_t * psPL, void * pvBuf, size_t Size);
+
+/**
+ * @brief		drain up to Max bytes to the handler, highest lane first
+ * @param[in]	Max - maximum bytes, 0 = everything buffered now
+ * @return		number of bytes drained, handler error or erFAILURE (EBUSY) if already being drained
+ * @note		The handler is called without the lock held, writers (to any lane) only wait for the
+ * 				copy, not for the sink. A higher lane written meanwhile is served next, partial
+ * 				acceptance stops the drain.
+ */
+int xPLBufEmptyLimit(plbuf_t * psPL, int (*hdlr)(const void *, size_t), size_t Max);
+
+int xPLBufEmptyBlock(plbuf_t * psPL, int (*hdlr)(const void *, size_t));
+
+struct report_t;
+int xPLBufReport(struct report_t * psR, plbuf_t * psPL);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,138 @@
+// x_token.c - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+#include "hal_platform.h"
+#include "hal_stdio.h"
+#include "x_token.h"
+#include "x_buffers.h"
+#include "x_ubuf.h"
+#include "x_uubuf.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define	debugFLAG					0xF000
+
+#define	debugTIMING					(debugFLAG_GLOBAL & debugFLAG & 0x1000)
+#define	debugTRACK					(debugFLAG_GLOBAL & debugFLAG & 0x2000)
+#define	debugPARAM					(debugFLAG_GLOBAL & debugFLAG & 0x4000)
+#define	debugRESULT					(debugFLAG_GLOBAL & debugFLAG & 0x8000)
+
+// ################################# Local/static functions ########################################
+
+static bool bTokIsEOL(char cChr) { return (cChr == CHR_CR) || (cChr == CHR_LF) || (cChr == CHR_NUL); }
+static bool bTokIsSep(char cChr) { return (cChr == CHR_SPACE) || (cChr == CHR_TAB); }
+
+// ################################### Global/public functions #####################################
+
+size_t xTokInit(token_t * psT, const char * pcBuf, size_t Len) {
+	const char * pcEnd = pcBuf + Len;
+	const char * pcNow = pcBuf;
+	while ((pcNow < pcEnd) && !bTokIsEOL(*pcNow))
+		++pcNow;
+	psT->pcNow = pcBuf;
+	psT->pcEnd = pcNow;
+	if (pcNow == pcEnd) {								// no terminator, line incomplete
+		psT->LineLen = 0;
+	} else {
+		if ((*pcNow == CHR_CR) && ((pcNow + 1) < pcEnd) && (pcNow[1] == CHR_LF))
+			++pcNow;									// CR/LF pair consumed as one
+		psT->LineLen = pcNow + 1 - pcBuf;
+	}
+	return psT->LineLen;
+}
+
+size_t xTokInitBuf(token_t * psT, buf_t * psBuf) {
+	size_t Len = psBuf->xUsed;
+	if (Len > (size_t) (psBuf->pEnd - psBuf->pRead))	// circular and wrapped ?
+		Len = psBuf->pEnd - psBuf->pRead;				// yes, first segment only
+	return xTokInit(psT, psBuf->pRead, Len);
+}
+
+size_t xTokInitUBuf(token_t * psT, ubuf_t * psUB) {
+	size_t Len;
+	const char * pcBuf = (const char *) pcUBufPeek(psUB, &Len);	// under the lock
+	if (pcBuf == NULL) {								// spilling or no storage, errno set
+		*psT = (token_t) { 0 };							// no tokens, errno set
+		return 0;
+	}
+	if ((xTokInit(psT, pcBuf, Len) == 0) && ((const u8_t *) pcBuf + Len == psUB->pBuf + psUB->Size)) {
+		errno = EOVERFLOW;								// incomplete line wraps, never completes in place
+		return 0;
+	}
+	return psT->LineLen;
+}
+
+size_t xTokInitUUBuf(token_t * psT, uubuf_t * psUUBuf) {
+	size_t Len;
+	const char * pcBuf = pcUUBufPeek(psUUBuf, &Len);
+	return xTokInit(psT, pcBuf, Len);
+}
+
+int xTokNext(token_t * psT, tokview_t * psV) {
+	while ((psT->pcNow < psT->pcEnd) && bTokIsSep(*psT->pcNow))
+		++psT->pcNow;									// skip leading white space
+	if (psT->pcNow == psT->pcEnd)
+		return 0;
+	*psV = (tokview_t) { 0 };
+	char cQuote = *psT->pcNow;
+	if ((cQuote == CHR_DQUOTE) || (cQuote == CHR_SQUOTE)) {
+		psV->f_quoted = 1;
+		++psT->pcNow;									// step over opening quote
+	} else {
+		cQuote = CHR_NUL;
+	}
+	const char * pcNow = psT->pcNow;
+	while (pcNow < psT->pcEnd) {
+		if (*pcNow == CHR_BACKSLASH) {					// escape, skip the next char whatever it is
+			psV->f_escaped = 1;
+			if (++pcNow == psT->pcEnd)
+				break;
+		} else if (cQuote ? (*pcNow == cQuote) : bTokIsSep(*pcNow)) {
+			break;
+		}
+		++pcNow;
+	}
+	if (cQuote && (pcNow == psT->pcEnd))
+		return erFAILURE;								// no closing quote on this line
+	psV->pcTok = psT->pcNow;
+	psV->Len = pcNow - psT->pcNow;						// size_t, no truncation of long tokens
+	psT->pcNow = cQuote ? (pcNow + 1) : pcNow;			// step over closing quote
+	return 1;
+}
+
+size_t xTokCopy(const tokview_t * psV, char * pcBuf, size_t Size) {
+	IF_myASSERT(debugPARAM, Size > 0);
+	size_t Len = 0;
+	for (const char * pcNow = psV->pcTok; (pcNow < (psV->pcTok + psV->Len)) && (Len < (Size - 1)); ++pcNow) {
+		if (psV->f_escaped && (*pcNow == CHR_BACKSLASH) && ((pcNow + 1) < (psV->pcTok + psV->Len)))
+			++pcNow;									// drop the escape, keep what follows
+		pcBuf[Len++] = *pcNow;
+	}
+	pcBuf[Len] = CHR_NUL;
+	return Len;
+}
+
+bool bTokMatch(const tokview_t * psV, const char * pcStr) {
+	return (strncmp(psV->pcTok, pcStr, psV->Len) == 0) && (pcStr[psV->Len] == CHR_NUL);
+}
+
+// ################################## Diagnostic and testing functions #############################
+
+void vTokTest(void) {
+	const char caLine[] = "  set  \"a b\\\" c\" x\\ y 'q'\r\nnext";
+	char caTok[16];
+	token_t sT;
+	tokview_t sV;
+	// line length includes CR/LF, tokens are views into the line
+	if (xTokInit(&sT, caLine, sizeof(caLine) - 1) != 27)						PX("Failed line" strNL);
+	if ((xTokNext(&sT, &sV) != 1) || !bTokMatch(&sV, "set") || bTokMatch(&sV, "se"))	PX("Failed plain" strNL);
+	if ((xTokNext(&sT, &sV) != 1) || !sV.f_quoted || !sV.f_escaped)				PX("Failed quoted" strNL);
+	if ((xTokCopy(&sV, caTok, sizeof(caTok)) != 6) || strcmp(caTok, "a b\" c"))	PX("Failed escape" strNL);
+	if ((xTokNext(&sT, &sV) != 1) || (xTokCopy(&sV, caTok, sizeof(caTok)) != 3))	PX("Failed escaped space" strNL);
+	if ((xTokNext(&sT, &sV) != 1) || (sV.Len != 1) || (*sV.pcTok != 'q'))		PX("Failed single quote" strNL);
+	if (xTokNext(&sT, &sV) != 0)												PX("Failed end of line" strNL);
+	// incomplete line and unterminated quote
+	if (xTokInit(&sT, "say \"oops", 9) != 0)									PX("Failed incomplete" strNL);
+	xTokNext(&sT, &sV);
+	if (xTokNext(&sT, &sV) != erFAILURE)										PX("Failed unterminated" strNL);
+}
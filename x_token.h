@@ -0,0 +1,79 @@
+// x_token.h - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+#pragma	once
+
+#include "definitions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ##################################### MACRO definitions #########################################
+
+
+// ####################################### structures  #############################################
+
+typedef struct tokview_t {			// token in place, NOT terminated
+	const char * pcTok;
+	size_t Len;
+	u8_t f_quoted:1;				// was enclosed in '...' or "...", quotes excluded from view
+	u8_t f_escaped:1;				// contains '\' escapes, use xTokCopy() to resolve
+	u8_t f_spare:6;
+} tokview_t;
+
+typedef struct token_t {			// tokenizer state over one line of buffered text
+	const char * pcNow;
+	const char * pcEnd;				// first line terminator (CR/LF/NUL) or end of data
+	size_t LineLen;					// bytes to consume incl terminator(s), 0 if no terminator seen
+} token_t;
+
+// ################################### EXTERNAL FUNCTIONS ##########################################
+
+/**
+ * @brief		initialise tokenizer on the first line of the memory supplied
+ * @param[in]	psT - pointer to tokenizer state
+ * @param[in]	pcBuf - start of text
+ * @param[in]	Len - bytes available
+ * @return		LineLen, bytes to consume once processed, 0 if line is incomplete
+ */
+size_t xTokInit(token_t * psT, const char * pcBuf, size_t Len);
+
+struct buf_s;
+struct ubuf_t;
+struct uubuf_t;
+
+/**
+ * @brief		initialise tokenizer on the first line of unread data in the buffer
+ * @return		LineLen, bytes to consume (xBufSeek/vUBufStepRead/xUUBufConsume) once processed
+ * @note		only the contiguous part at the read position is scanned, nothing is consumed
+ * @note		ubuf_t: 0 with errno EBUSY while spilling, ENODATA or ENOMEM without storage (see
+ * 				pcUBufPeek()), or EOVERFLOW if the incomplete line wraps
+ * 				round the end of the ring, read it with xUBufRead() and use xTokInit() instead
+ */
+size_t xTokInitBuf(token_t * psT, struct buf_s * psBuf);
+size_t xTokInitUBuf(token_t * psT, struct ubuf_t * psUB);
+size_t xTokInitUUBuf(token_t * psT, struct uubuf_t * psUUBuf);
+
+/**
+ * @brief		return the next token as a view into the buffer
+ * @param[in]	psT - pointer to tokenizer state
+ * @param[out]	psV - pointer to token view to be filled
+ * @return		1 if token found, 0 if no more tokens on the line, erFAILURE if unterminated quote
+ */
+int xTokNext(token_t * psT, tokview_t * psV);
+
+/**
+ * @brief		copy token to buffer supplied, resolving escapes, and terminate
+ * @return		length of string copied excluding terminator
+ */
+size_t xTokCopy(const tokview_t * psV, char * pcBuf, size_t Size);
+
+/**
+ * @brief		compare token with a string without copying
+ * @return		true if identical (escapes NOT resolved)
+ */
+bool bTokMatch(const tokview_t * psV, const char * pcStr);
+
+#ifdef __cplusplus
+}
+#endif
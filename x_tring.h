@@ -0,0 +1,86 @@
+// x_tring.h - Copyright (c) 2026 Andre M. Maree / KSS Technologies (Pty) Ltd.
+
+/* Typed ring of fixed size elements, generated per element type:
+ *
+ *		typedef struct { i32_t X, Y, Z; } smpl_t;
+ *		TRING_DEFINE(SmplRing, smpl_t, 64)
+ *
+ * creates type SmplRing_t and the inline functions vSmplRingInit(), xSmplRingUsed(), xSmplRingSpace(),
+ * bSmplRingPush(), bSmplRingPop(), xSmplRingPushN(), xSmplRingPopN() and psSmplRingPeek().
+ *
+ * Capacity MUST be a power of 2. IdxWR and IdxRD are free running and masked on access, hence no
+ * % and no "full vs empty" ambiguity. Lock free for ONE producer and ONE consumer, any other use
+ * must be serialised by the caller. Bulk functions copy whole element runs with at most 2 memcpy.
+ */
+
+#pragma	once
+
+#include "definitions.h"
+
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ##################################### MACRO definitions #########################################
+
+#define	TRING_DEFINE(name, type, capacity)													\
+typedef struct name##_t {																	\
+	volatile u32_t IdxWR;					/* free running count of elements written */		\
+	volatile u32_t IdxRD;					/* free running count of elements read */			\
+	type Buf[capacity];																		\
+} name##_t;																					\
+DUMB_STATIC_ASSERT(((capacity) > 1) && (((capacity) & ((capacity) - 1)) == 0));				\
+																							\
+static inline void v##name##Init(name##_t * psR) { psR->IdxWR = psR->IdxRD = 0; }			\
+																							\
+static inline size_t x##name##Used(name##_t * psR) {										\
+	return __atomic_load_n(&psR->IdxWR, __ATOMIC_ACQUIRE) - __atomic_load_n(&psR->IdxRD, __ATOMIC_ACQUIRE);	\
+}																							\
+																							\
+static inline size_t x##name##Space(name##_t * psR) { return (capacity) - x##name##Used(psR); }	\
+																							\
+static inline size_t x##name##PushN(name##_t * psR, const type * psE, size_t Num) {			\
+	u32_t IdxWR = psR->IdxWR;																\
+	size_t Space = (capacity) - (IdxWR - __atomic_load_n(&psR->IdxRD, __ATOMIC_ACQUIRE));	\
+	if (Num > Space)																		\
+		Num = Space;																		\
+	u32_t Idx = IdxWR & ((capacity) - 1);													\
+	size_t Now = (capacity) - Idx;						/* elements till end of array */		\
+	if (Now > Num)																			\
+		Now = Num;																			\
+	memcpy(&psR->Buf[Idx], psE, Now * sizeof(type));										\
+	if (Num > Now)										/* wrapped, rest at the start */		\
+		memcpy(&psR->Buf[0], psE + Now, (Num - Now) * sizeof(type));						\
+	__atomic_store_n(&psR->IdxWR, IdxWR + Num, __ATOMIC_RELEASE);							\
+	return Num;																				\
+}																							\
+																							\
+static inline size_t x##name##PopN(name##_t * psR, type * psE, size_t Num) {				\
+	u32_t IdxRD = psR->IdxRD;																\
+	size_t Used = __atomic_load_n(&psR->IdxWR, __ATOMIC_ACQUIRE) - IdxRD;					\
+	if (Num > Used)																			\
+		Num = Used;																			\
+	u32_t Idx = IdxRD & ((capacity) - 1);													\
+	size_t Now = (capacity) - Idx;															\
+	if (Now > Num)																			\
+		Now = Num;																			\
+	memcpy(psE, &psR->Buf[Idx], Now * sizeof(type));										\
+	if (Num > Now)																			\
+		memcpy(psE + Now, &psR->Buf[0], (Num - Now) * sizeof(type));						\
+	__atomic_store_n(&psR->IdxRD, IdxRD + Num, __ATOMIC_RELEASE);							\
+	return Num;																				\
+}																							\
+																							\
+static inline bool b##name##Push(name##_t * psR, const type * psE) { return x##name##PushN(psR, psE, 1) == 1; }	\
+static inline bool b##name##Pop(name##_t * psR, type * psE) { return x##name##PopN(psR, psE, 1) == 1; }			\
+																							\
+/* oldest element, NOT consumed, NULL if empty */												\
+static inline type * ps##name##Peek(name##_t * psR) {										\
+	return x##name##Used(psR) ? &psR->Buf[psR->IdxRD & ((capacity) - 1)] : NULL;			\
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -13,7 +13,9 @@
 
 #include <errno.h>
 #include <stdatomic.h>
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #define	debugFLAG					0xF000
 
@@ -26,25 +28,130 @@
 
 #define	ubufMAX_OPEN				3
 #define	ubufSIZE_MINIMUM			32
-#define	ubufSIZE_MAXIMUM			16384
 #define	ubufSIZE_DEFAULT			1024
+#define	ubufFNV_SEED				2166136261UL
+#define	ubufFNV_PRIME				16777619UL
+#define	ubufHIST_MAGIC				0x46425548UL	// "HUBF"
+#define	ubufZIP_ALLOC(b,a)			(sizeof(ubuf_zip_t) + blzHASH_SIZE + (b) + (a))	// single allocation
 
 // #################################### PRIVATE structures #########################################
 
 static size_t uBufSize = ubufSIZE_DEFAULT;
+static const balloc_t * psUBufAlloc = NULL;			// allocator for VFS opened buffers
+static u32_t uBufCaps = ballocCAP_DEFAULT;
+
+typedef struct __attribute__((packed)) ubuf_hist_t {	// history log image, ring contents follow
+	u32_t IdxWR;
+	u32_t Used;
+} ubuf_hist_t;
+
+typedef struct ubuf_reg_t {							// ring that may release idle storage
+	ubuf_t * psUB;
+	u32_t Caps;										// to reallocate with
+	u32_t Seq;										// ring Seq when last scanned
+	TickType_t tSeen;								// tick at which Seq last changed
+} ubuf_reg_t;
+
+static ubuf_reg_t sUBufReg[ubufRECLAIM_MAX] = { 0 };
+
+static ubuf_stage_t * psUBufStages = NULL;			// all task stages, see vUBufSetStaged()
+static SemaphoreHandle_t muxUBufStage = NULL;
+static SemaphoreHandle_t muxUBufReg = NULL;
 
 // ################################# Local/static functions ########################################
 
+/* Paths changing IdxWR, IdxRD, Used or pBuf lock with xUBufLock(): Seq is odd while they hold the
+ * lock, allowing xUBufSnapshot() to detect and retry a copy that raced with a modification. Paths
+ * that only look, or change attachments, use xUBufLockRO() and leave Seq alone. */
 static void xUBufLock(ubuf_t * psUB) {
 	if (psUB->f_nolock == 0)
 		xRtosSemaphoreTake(&psUB->mux, portMAX_DELAY); 
+	__atomic_store_n(&psUB->Seq, psUB->Seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);			// odd Seq visible before any change
 }
 
 static void xUBufUnLock(ubuf_t * psUB) {
+	__atomic_store_n(&psUB->Seq, psUB->Seq + 1, __ATOMIC_RELEASE);	// changes visible before even Seq
+	if (psUB->f_nolock == 0)
+		xRtosSemaphoreGive(&psUB->mux);
+}
+
+static void xUBufLockRO(ubuf_t * psUB) {
+	if (psUB->f_nolock == 0)
+		xRtosSemaphoreTake(&psUB->mux, portMAX_DELAY);
+}
+
+static void xUBufUnLockRO(ubuf_t * psUB) {
 	if (psUB->f_nolock == 0)
 		xRtosSemaphoreGive(&psUB->mux);
 }
 
+/**
+ * @brief		copy Len bytes from ring index Idx and check the ring was not modified since Seq
+ * @return		true if the copy is consistent
+ */
+static bool bUBufSnapCopy(ubuf_t * psUB, u32_t Seq, size_t Idx, u8_t * pu8, size_t Len) {
+	u8_t * pBuf = psUB->pBuf;							// once, might be released meanwhile
+	if ((Seq & 1) || (pBuf == NULL))
+		return false;
+	size_t Seg = psUB->Size - Idx;
+	if (Seg > Len)
+		Seg = Len;
+	memcpy(pu8, pBuf + Idx, Seg);
+	memcpy(pu8 + Seg, pBuf, Len - Seg);
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);			// copy complete before Seq checked again
+	return __atomic_load_n(&psUB->Seq, __ATOMIC_RELAXED) == Seq;
+}
+
+/**
+ * @brief		lock the buffer only if available now, as used by the reclaim hook
+ * @return		true if locked
+ */
+static bool bUBufTryLock(ubuf_t * psUB) {
+	if (xRtosSemaphoreTake(&psUB->mux, 0) != pdTRUE)
+		return false;
+	__atomic_store_n(&psUB->Seq, psUB->Seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	return true;
+}
+
+/**
+ * @brief		reallocate storage released by xUBufReclaim(), buffer NOT locked
+ * @return		erSUCCESS or erFAILURE with errno set
+ * @note		allocated outside the lock, discarded if another writer reallocated first
+ */
+static int xUBufRealloc(ubuf_t * psUB) {
+	u32_t Caps = ballocCAP_DEFAULT;
+	xRtosSemaphoreTake(&muxUBufReg, portMAX_DELAY);
+	for (int i = 0; i < ubufRECLAIM_MAX; ++i) {
+		if (sUBufReg[i].psUB == psUB)
+			Caps = sUBufReg[i].Caps;
+	}
+	xRtosSemaphoreGive(&muxUBufReg);
+	u8_t * pBuf = pvBAllocType(psUB->psA, ballocTYPE_UBUF, psUB->Size, Caps);
+	if (pBuf == NULL) {
+		errno = ENOMEM;
+		return erFAILURE;
+	}
+	xUBufLock(psUB);
+	if (psUB->f_reclaim) {
+		psUB->pBuf = pBuf;
+		psUB->f_reclaim = 0;
+		pBuf = NULL;
+	}
+	xUBufUnLock(psUB);
+	vBFreeType(psUB->psA, ballocTYPE_UBUF, pBuf, psUB->Size);	// NULL if installed
+	return erSUCCESS;
+}
+
+/**
+ * @brief		update an attached digest for its side, buffer MUST be locked
+ */
+static void vUBufDigest(ubuf_t * psUB, int Side, const void * pvBuf, size_t Len) {
+	if (psUB->psDig && (psUB->psDig->Side == Side))
+		vBufDigUpdate(psUB->psDig, pvBuf, Len);
+}
+
 /**
  * @brief		check if a character is available to be read
  * @param[in]	psUBuf - pointer to buffer control structure
@@ -52,21 +159,318 @@ static void xUBufUnLock(ubuf_t * psUB) {
  * @note		might block until a character is availoble depending on O_NONBLOCK being set..
  */
 static int xUBufCheckAvail(ubuf_t * psUB) {
-	if ((psUB->pBuf == NULL) || (psUB->Size == 0)) {
+	if (((psUB->pBuf == NULL) && (psUB->f_reclaim == 0)) || (psUB->Size == 0)) {
 		errno = ENOMEM; 
 		return erFAILURE;
 	}
-	if (psUB->Used == 0) {
+	if (xUBufGetUsed(psUB) == 0) {
 		if (FF_STCHK(psUB, O_NONBLOCK)) {
 			errno = EAGAIN; 
 			return EOF;
 		}
-		while (psUB->Used == 0)
-			vTaskDelay(pdMS_TO_TICKS(2));
+		while (xUBufGetUsed(psUB) == 0)
+			vBufOvfDelay();
 	}
 	return erSUCCESS;
 }
 
+static u32_t xUBufSpillUsed(ubuf_t * psUB) {
+	return psUB->psSpill ? (psUB->psSpill->OffWR - psUB->psSpill->OffRD) : 0;
+}
+
+/* Compressed arena: blocks are stored contiguously, a block that does not fit at the end of the
+ * arena starts at 0 and the tail space is skipped, marked by a Zip=0 header if there is room. */
+
+/**
+ * @brief		step over skipped tail space at the oldest block
+ */
+static void vUBufZipHead(ubuf_zip_t * psZ) {
+	u16_t Zip;
+	if (psZ->Used && (((psZ->Size - psZ->OffHD) < (2 * sizeof(u16_t))) ||
+		(memcpy(&Zip, psZ->pArena + psZ->OffHD, sizeof(Zip)), Zip == 0))) {
+		psZ->Used -= psZ->Size - psZ->OffHD;
+		psZ->OffHD = 0;
+	}
+	if (psZ->Used == 0)
+		psZ->OffHD = psZ->OffTL = 0;
+}
+
+/**
+ * @brief		remove the oldest block from the arena
+ */
+static void vUBufZipPop(ubuf_zip_t * psZ) {
+	u16_t Zip;
+	memcpy(&Zip, psZ->pArena + psZ->OffHD, sizeof(Zip));
+	psZ->OffHD += (2 * sizeof(u16_t)) + Zip;
+	psZ->Used -= (2 * sizeof(u16_t)) + Zip;
+	if (psZ->OffHD == psZ->Size)
+		psZ->OffHD = 0;
+	psZ->RawLen = psZ->RawOff = 0;
+	vUBufZipHead(psZ);
+}
+
+/**
+ * @brief		make Need contiguous bytes available at OffTL, evicting oldest blocks if required
+ */
+static void vUBufZipRoom(ubuf_spill_t * psS, size_t Need) {
+	ubuf_zip_t * psZ = psS->psZ;
+	while (psZ->Used) {
+		if (psZ->OffTL > psZ->OffHD) {					// free space at the end AND the start
+			if ((psZ->Size - psZ->OffTL) >= Need)
+				return;
+			if (psZ->OffHD >= Need) {					// skip the tail, continue at the start
+				if ((psZ->Size - psZ->OffTL) >= (2 * sizeof(u16_t)))
+					memset(psZ->pArena + psZ->OffTL, 0, 2 * sizeof(u16_t));
+				psZ->Used += psZ->Size - psZ->OffTL;
+				psZ->OffTL = 0;
+				return;
+			}
+		} else if ((psZ->OffTL < psZ->OffHD) && ((psZ->OffHD - psZ->OffTL) >= Need)) {
+			return;
+		}
+		u16_t Raw;										// evict oldest, unread part is lost
+		memcpy(&Raw, psZ->pArena + psZ->OffHD + sizeof(u16_t), sizeof(Raw));
+		Raw -= psZ->RawOff;
+		psZ->Lost += Raw;
+		psS->OffRD += Raw;
+		vUBufZipPop(psZ);
+		if (psS->OffRD == psS->OffWR)
+			psS->OffRD = psS->OffWR = psS->OffOK = 0;
+	}
+}
+
+/**
+ * @brief		compress Req oldest bytes from RAM into the arena, buffer MUST be locked
+ * @note		a block never spans the RAM wrap point, it is simply shorter
+ */
+static void vUBufZipOut(ubuf_t * psUB, size_t Req) {
+	ubuf_spill_t * psS = psUB->psSpill;
+	ubuf_zip_t * psZ = psS->psZ;
+	while (Req) {
+		size_t Now = psUB->Size - psUB->IdxRD;
+		if (Now > Req)
+			Now = Req;
+		if (Now > psZ->Block)
+			Now = psZ->Block;
+		vUBufZipRoom(psS, (2 * sizeof(u16_t)) + Now);
+		u8_t * pDst = psZ->pArena + psZ->OffTL;
+		u8_t * pSrc = psUB->pBuf + psUB->IdxRD;
+		u16_t aHdr[2] = { xBLzPack(pSrc, Now, pDst + sizeof(aHdr), Now - 1, psZ->pHash), Now };
+		if (aHdr[0] == 0) {								// incompressible, store as is
+			memcpy(pDst + sizeof(aHdr), pSrc, Now);
+			aHdr[0] = Now;
+		}
+		memcpy(pDst, aHdr, sizeof(aHdr));
+		psZ->OffTL += sizeof(aHdr) + aHdr[0];
+		psZ->Used += sizeof(aHdr) + aHdr[0];
+		if (psZ->OffTL == psZ->Size)
+			psZ->OffTL = 0;
+		psUB->IdxRD = (psUB->IdxRD + Now) % psUB->Size;
+		psUB->Used -= Now;
+		psS->OffWR += Now;
+		psS->OffOK = psS->OffWR;						// compressed in place, nothing in flight
+		psS->Total += Now;
+		Req -= Now;
+	}
+}
+
+/**
+ * @brief		copy from the oldest block, decompressing it first if required
+ * @return		number of bytes copied or erFAILURE with errno set
+ */
+static ssize_t xUBufZipPeek(ubuf_zip_t * psZ, void * pBuf, size_t Size) {
+	if (psZ->RawLen == 0) {
+		u16_t aHdr[2];
+		u8_t * pSrc = psZ->pArena + psZ->OffHD;
+		memcpy(aHdr, pSrc, sizeof(aHdr));
+		pSrc += sizeof(aHdr);
+		if (aHdr[0] == aHdr[1]) {
+			memcpy(psZ->pRaw, pSrc, aHdr[1]);
+		} else if (xBLzUnpack(pSrc, aHdr[0], psZ->pRaw, psZ->Block) != aHdr[1]) {
+			errno = EIO;
+			return erFAILURE;
+		}
+		psZ->RawLen = aHdr[1];
+	}
+	if (Size > (psZ->RawLen - psZ->RawOff))
+		Size = psZ->RawLen - psZ->RawOff;
+	memcpy(pBuf, psZ->pRaw + psZ->RawOff, Size);
+	return Size;
+}
+
+/**
+ * @brief		move oldest data from RAM to the spill file or compressed arena to make space for Size bytes
+ * @param[in]	psUB - pointer to buffer control structure
+ * @return		erSUCCESS or erFAILURE if file limit reached or I/O failed
+ * @note		A file chunk is copied to pXfer and removed from RAM under the buffer lock, then written
+ * 				holding only the file mutex. OffWR reserves its place, readers see it once OffOK moves.
+ */
+static int xUBufSpillOut(ubuf_t * psUB, size_t Size) {
+	ubuf_spill_t * psS;
+	while (true) {
+		xUBufLock(psUB);
+		psS = psUB->psSpill;
+		if (psS == NULL) {								// stopped while writing previous chunk
+			xUBufUnLock(psUB);
+			errno = ENOSPC;
+			return erFAILURE;
+		}
+		ssize_t Req = Size - (psUB->Size - psUB->Used);	// calculate shortfall
+		if (Req <= 0)									// might have changed since checked
+			break;
+		if (psS->psZ) {
+			if (Req < psS->Chunk)
+				Req = psS->Chunk;						// fewer, larger blocks
+			vUBufZipOut(psUB, (Req > psUB->Used) ? psUB->Used : Req);	// never fails, evicts old blocks
+			break;
+		}
+		if (psS->OffOK != psS->OffWR) {					// other writer's chunk in flight
+			xUBufUnLock(psUB);
+			vBufOvfDelay();
+			continue;
+		}
+		Req = (psS->Chunk < psUB->Used) ? psS->Chunk : psUB->Used;	// one chunk per pass
+		if (psS->Max && ((psS->OffWR + Req) > psS->Max)) {
+			xUBufUnLock(psUB);
+			errno = ENOSPC;
+			return erFAILURE;
+		}
+		size_t Now = psUB->Size - psUB->IdxRD;			// bytes from IdxRD to end of buffer
+		if (Now > Req)
+			Now = Req;
+		memcpy(psS->pXfer, psUB->pBuf + psUB->IdxRD, Now);
+		memcpy(psS->pXfer + Now, psUB->pBuf, Req - Now);
+		psUB->IdxRD = (psUB->IdxRD + Req) % psUB->Size;
+		psUB->Used -= Req;
+		u32_t Off = psS->OffWR;
+		psS->OffWR += Req;								// reserved, readers stop at OffOK
+		xUBufUnLock(psUB);
+
+		xRtosSemaphoreTake(&psS->mux, portMAX_DELAY);	// storage latency, buffer NOT locked
+		bool bOK = (lseek(psS->fd, Off, SEEK_SET) == (off_t) Off) && (write(psS->fd, psS->pXfer, Req) == Req);
+		xUBufLock(psUB);								// file mutex first is safe, readers only try it
+		if (bOK) {
+			psS->OffOK = psS->OffWR;
+			psS->Total += Req;
+		} else {										// chunk lost, release its place
+			psS->Lost += Req;
+			psS->OffWR = psS->OffOK = Off;
+			if (psS->OffRD > Off)
+				psS->OffRD = Off;						// reset while in flight
+		}
+		xUBufUnLock(psUB);
+		xRtosSemaphoreGive(&psS->mux);
+		if (bOK == false) {
+			errno = EIO;
+			return erFAILURE;
+		}
+	}
+	xUBufUnLock(psUB);
+	return erSUCCESS;
+}
+
+/**
+ * @brief		copy oldest spilled data without consuming it, buffer MUST be locked
+ * @return		number of bytes copied or erFAILURE with errno set
+ */
+static ssize_t xUBufSpillPeek(ubuf_spill_t * psS, void * pBuf, size_t Size) {
+	if (Size > (psS->OffOK - psS->OffRD))
+		Size = psS->OffOK - psS->OffRD;
+	if (psS->psZ)
+		return xUBufZipPeek(psS->psZ, pBuf, Size);
+	if ((Size == 0) || (xRtosSemaphoreTake(&psS->mux, 0) != pdTRUE)) {
+		errno = EAGAIN;									// being written, never wait with the lock held
+		return erFAILURE;
+	}
+	ssize_t sRV = (lseek(psS->fd, psS->OffRD, SEEK_SET) == (off_t) psS->OffRD) ? read(psS->fd, pBuf, Size) : erFAILURE;
+	xRtosSemaphoreGive(&psS->mux);
+	return sRV;
+}
+
+/**
+ * @brief		consume spilled data, buffer MUST be locked
+ */
+static void vUBufSpillStep(ubuf_spill_t * psS, size_t Step) {
+	if (psS->psZ && ((psS->psZ->RawOff += Step) == psS->psZ->RawLen))
+		vUBufZipPop(psS->psZ);							// oldest block fully consumed
+	psS->OffRD += Step;
+	if (psS->OffRD == psS->OffWR)						// never while in flight, OffWR is beyond
+		psS->OffRD = psS->OffWR = psS->OffOK = 0;		// all consumed, reuse file from the start
+}
+
+/**
+ * @brief		drain spilled data to the handler, buffer MUST be locked
+ * @return		last handler return value or erFAILURE if spill file could not be read
+ */
+static int xUBufSpillDrain(ubuf_t * psUB, int (*hdlr)(const void *, size_t), size_t Max, ssize_t * pTotal) {
+	ubuf_spill_t * psS = psUB->psSpill;
+	u8_t caBuf[ubufSPILL_XFER];
+	int iRV = 0;
+	while ((psS->OffWR > psS->OffRD) && (*pTotal < Max)) {
+		size_t Now = Max - *pTotal;
+		if (Now > sizeof(caBuf))
+			Now = sizeof(caBuf);
+		ssize_t sRV = xUBufSpillPeek(psS, caBuf, Now);
+		if (sRV <= 0)
+			return erFAILURE;
+		iRV = hdlr(caBuf, sRV);
+		if (iRV <= 0)
+			break;
+		vUBufDigest(psUB, bufDIG_DRAIN, caBuf, iRV);
+		vUBufSpillStep(psS, iRV);
+		*pTotal += iRV;
+		if (iRV < sRV)									// sink full, try again later
+			break;
+	}
+	return iRV;
+}
+
+/**
+ * @brief		apply the attached overflow policy, write of Size bytes does not fit
+ * @param[in]	psUB - pointer to buffer control structure
+ * @return		number of bytes that may be written or bufOVF_DROP if write to be discarded
+ */
+static ssize_t xUBufOverflow(ubuf_t * psUB, size_t Size) {
+	bufovf_t * psO = psUB->psOvf;
+	ssize_t Avail = psUB->Size - psUB->Used;
+	switch (psO->Policy) {
+	case bufPOLICY_BLOCK: {
+		TickType_t tStart = xTaskGetTickCount();
+		while ((Avail = xUBufGetSpace(psUB)) < Size) {
+			if ((xTaskGetTickCount() - tStart) >= pdMS_TO_TICKS(psO->msWait)) {
+				vBufOvfEvent(psO, psUB, bufOVF_TIMEOUT, Size, 0, Size);
+				errno = ETIMEDOUT;
+				return bufOVF_DROP;
+			}
+			vBufOvfDelay();
+		}
+		vBufOvfEvent(psO, psUB, bufOVF_BLOCKED, Size, Size, 0);
+		return Size;
+	}
+	case bufPOLICY_DROPNEW:
+		vBufOvfEvent(psO, psUB, bufOVF_DROPNEW, Size, 0, Size);
+		errno = ENOSPC;
+		return bufOVF_DROP;
+
+	case bufPOLICY_DROPOLD: {
+		xUBufLock(psUB);
+		int Req = Size - (psUB->Size - psUB->Used);		// calculate shortfall
+		if (Req > 0) {									// might have changed since checked
+			psUB->IdxRD += Req;
+			psUB->IdxRD %= psUB->Size;
+			psUB->Used -= Req;
+		}
+		xUBufUnLock(psUB);
+		vBufOvfEvent(psO, psUB, bufOVF_DROPOLD, Size, Size, (Req > 0) ? Req : 0);
+		return Size;
+	}
+	default:											// bufPOLICY_PARTIAL
+		vBufOvfEvent(psO, psUB, bufOVF_PARTIAL, Size, Avail, Size - Avail);
+		errno = EAGAIN;
+		return Avail;
+	}
+}
+
 /**
  * @brief		wait till an empty block of specified size is available 
  * @param[in]	psUBuf - pointer to buffer control structure
@@ -80,6 +484,10 @@ static ssize_t xUBufBlockSpace(ubuf_t * psUB, size_t Size) {
 	ssize_t Avail = psUB->Size - psUB->Used;
 	if (Avail >= Size)									// sufficient space ?
 		return Size;									// yes, return
+	if (psUB->psSpill && (xUBufSpillOut(psUB, Size) == erSUCCESS))
+		return Size;									// oldest data moved to storage
+	if (psUB->psOvf && (psUB->psOvf->Policy != bufPOLICY_LEGACY))
+		return xUBufOverflow(psUB, Size);				// explicit policy overrides flags
 
 	// Step 2: insufficient space available, free some up if possible
 	if (psUB->f_history || FF_STCHK(psUB, O_TRUNC)) {	// supposed to TRUNCate ?
@@ -97,81 +505,346 @@ static ssize_t xUBufBlockSpace(ubuf_t * psUB, size_t Size) {
 
 	} else {											// block till available
 		do {											// loop waiting for sufficient space
-			if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
-				vTaskDelay(pdMS_TO_TICKS(2));						
-			} else {
-				vClockDelayMsec(2);
-			}
+			vBufOvfDelay();
 		} while (xUBufGetSpace(psUB) < Size);			// wait for space to open...
 	}
 	return Size;
 }
 
+/**
+ * @brief		wake the drain task when the buffer goes non-empty or crosses the high water mark
+ * @param[in]	psF - pointer to drain task control structure
+ * @param[in]	Was - bytes used before the write
+ * @param[in]	Now - bytes used after the write
+ * @note		called with the buffer locked, wakes the task at most twice per fill cycle
+ */
+static void vUBufFlushKick(ubuf_flush_t * psF, ubidx_t Was, ubidx_t Now) {
+	if (Was == 0) {
+		psF->tFirst = xTaskGetTickCount();				// start the latency clock
+	} else if ((Was >= psF->HiWater) || (Now < psF->HiWater)) {
+		return;											// no threshold crossed, let it sleep
+	}
+	if (psF->xTask)
+		xTaskNotifyGive(psF->xTask);
+}
+
+static void vUBufFlushTask(void * pvPara) {
+	ubuf_flush_t * psF = pvPara;
+	ubuf_t * psUB = psF->psUB;
+	while (psF->f_run) {
+		TickType_t tWait = portMAX_DELAY;				// empty, sleep till first write
+		if (xUBufGetUsed(psUB)) {
+			TickType_t tAge = xTaskGetTickCount() - psF->tFirst;
+			TickType_t tMax = pdMS_TO_TICKS(psF->msLatency);
+			tWait = (tAge < tMax) ? (tMax - tAge) : 0;
+		}
+		if (tWait && (xUBufGetUsed(psUB) < psF->HiWater)) {		// neither deadline nor watermark reached
+			ulTaskNotifyTake(pdTRUE, tWait);
+			continue;
+		}
+		int iRV = xUBufEmptyLimit(psUB, psF->hdlr, psF->MaxPass);
+		if (iRV <= 0)									// sink stalled or failed, back off
+			vTaskDelay(pdMS_TO_TICKS(ubufFLUSH_RETRY_MS));
+		// capped pass: tFirst kept, the rest is already overdue and drained by the next pass
+	}
+	psF->xTask = NULL;
+	vTaskDelete(NULL);
+}
+
+/**
+ * @brief		run each filter stage once, moving data as far down the chain as scratch space allows
+ * @param[in]	pIn/Len - input to the first stage, *pUsed bytes of it already consumed
+ * @return		true if any stage consumed or produced something
+ */
+static bool bUBufChainStep(ubuf_chain_t * psC, const u8_t * pIn, size_t Len, size_t * pUsed) {
+	bool bMoved = false;
+	for (int i = 0; i < psC->Stages; ++i) {
+		ubuf_filt_t * psF = &psC->sFilt[i];
+		ubuf_filt_t * psP = i ? &psC->sFilt[i - 1] : NULL;
+		const u8_t * pSrc = psP ? (psP->caOut + psP->RD) : (pIn + *pUsed);
+		size_t Avail = psP ? (psP->WR - psP->RD) : (Len - *pUsed);
+		if (psF->RD && (psF->RD == psF->WR)) {
+			psF->RD = psF->WR = 0;						// all taken, restart at the front
+		} else if (psF->RD) {							// move the (short) remainder to the front
+			memmove(psF->caOut, psF->caOut + psF->RD, psF->WR - psF->RD);
+			psF->WR -= psF->RD;
+			psF->RD = 0;
+		}
+		size_t Room = sizeof(psF->caOut) - psF->WR;
+		if ((Avail == 0) || (Room == 0))
+			continue;
+		size_t Used = 0;
+		size_t Made = psF->xform(psF, pSrc, Avail, &Used, psF->caOut + psF->WR, Room);
+		psF->WR += Made;
+		if (psP)
+			psP->RD += Used;
+		else
+			*pUsed += Used;
+		if (Used || Made)
+			bMoved = true;
+	}
+	return bMoved;
+}
+
+/**
+ * @brief		push input through the chain and the last stage output to the sink, until the input is
+ * 				consumed and the chain empty, or the sink is full
+ * @param[out]	pUsed - number of input bytes consumed by the first stage
+ * @return		last handler return value
+ */
+static int xUBufChainFeed(ubuf_chain_t * psC, const u8_t * pIn, size_t Len, size_t * pUsed) {
+	ubuf_filt_t * psL = &psC->sFilt[psC->Stages - 1];
+	int iRV = 0;
+	*pUsed = 0;
+	while (1) {
+		bool bMoved = bUBufChainStep(psC, pIn, Len, pUsed);
+		size_t Now = psL->WR - psL->RD;
+		if (Now) {
+			iRV = psC->hdlr(psL->caOut + psL->RD, Now);
+			if (iRV <= 0)
+				break;
+			psL->RD += iRV;
+			if (iRV < Now)								// sink full, try again later
+				break;
+			bMoved = true;
+		}
+		if (bMoved == 0)
+			break;
+	}
+	return iRV;
+}
+
 // ################################### Global/public functions #####################################
 
 size_t xUBufSetDefaultSize(size_t NewSize) {
 	return uBufSize = INRANGE(ubufSIZE_MINIMUM, NewSize, ubufSIZE_MAXIMUM) ? NewSize : ubufSIZE_DEFAULT;
 }
 
-int	xUBufGetUsed(ubuf_t * psUB) { return psUB->Used; }
+int	xUBufGetUsed(ubuf_t * psUB) { return psUB->Used + xUBufSpillUsed(psUB); }
 
 int	xUBufGetSpace(ubuf_t * psUB) {
 	#if 0
 	int iRV = psUB->Size;
 	return __atomic_sub_fetch(&iRV, psUB->Used, __ATOMIC_RELAXED);
 	#else
-	xUBufLock(psUB);
+	xUBufLockRO(psUB);
 	int iRV = psUB->Size - psUB->Used; 
-	xUBufUnLock(psUB);
+	xUBufUnLockRO(psUB);
 	return iRV;
 	#endif
 }
 
-int xUBufEmptyBlock(ubuf_t * psUB, int (*hdlr)(const void *, size_t)) {
+int xUBufEmptyLimit(ubuf_t * psUB, int (*hdlr)(const void *, size_t), size_t Max) {
 	IF_myASSERT(debugPARAM, (hdlr != NULL) && halMemoryRAM(psUB));
-	if (psUB->Used == 0)
+	if (xUBufGetUsed(psUB) == 0)
 		return 0;
+	if (Max == 0)
+		Max = xUBufGetUsed(psUB);						// no limit, everything buffered now
 	int iRV = 0;
 	ssize_t Total = 0;
 	xUBufLock(psUB);
-	/* Partial writes are NORMAL here: xTelnetWrite() is a socket send and xStdOutWrite() a UART
-	 * write, both may take less than offered. IdxRD must therefore advance by what was ACCEPTED. */
-	// Check 1: if read pointer is ahead of the write pointer we MIGHT have 2 blocks to process
-	if (psUB->IdxRD) {
-		ssize_t Now = psUB->Size - psUB->IdxRD;			// write bytes between IdxRd and end of buffer
-		iRV = hdlr(psUB->pBuf + psUB->IdxRD, Now);
-		if (iRV > 0) {
-			Total += iRV;								// Update bytes written count
-			psUB->Used -= iRV;							// decrease total available
-			psUB->IdxRD += iRV;							// advance by what was accepted, full or partial
-			psUB->IdxRD %= psUB->Size;					// wraps to 0 ONLY if this block fully drained
-		}
-	}
-	// Check 2: anything (left) at start of circular buffer? ONLY once Check 1 wrapped, else the
-	// unsent tail of the [IdxRD,Size) block is still pending and pBuf[0] is not the read point.
-	if ((iRV >= 0) && psUB->Used && (psUB->IdxRD == 0)) {
-		iRV = hdlr(psUB->pBuf, psUB->Used);
-		if (iRV > 0) {
-			Total += iRV;
-			psUB->Used -= iRV;
-			if (psUB->Used == 0)
-				psUB->IdxRD = psUB->IdxWR = 0;			// fully drained, safe to reset both
-			else
+	// Check 0: spilled data is older than anything in RAM, hence MUST go first
+	if (psUB->psSpill)
+		iRV = xUBufSpillDrain(psUB, hdlr, Max, &Total);
+	if ((iRV >= 0) && (xUBufSpillUsed(psUB) == 0)) {
+		/* Partial writes are NORMAL here: xTelnetWrite() is a socket send and xStdOutWrite() a UART
+		 * write, both may take less than offered. IdxRD must therefore advance by what was ACCEPTED. */
+		// Check 1: if read pointer is ahead of the write pointer we MIGHT have 2 blocks to process
+		if (psUB->IdxRD && psUB->Used && (Total < Max)) {
+			ssize_t Now = psUB->Size - psUB->IdxRD;		// write bytes between IdxRd and end of buffer
+			if (Now > psUB->Used)						// not wrapped, stop at IdxWR
+				Now = psUB->Used;
+			if (Now > (Max - Total))
+				Now = Max - Total;
+			iRV = hdlr(psUB->pBuf + psUB->IdxRD, Now);
+			if (iRV > 0) {
+				vUBufDigest(psUB, bufDIG_DRAIN, psUB->pBuf + psUB->IdxRD, iRV);
+				Total += iRV;							// Update bytes written count
+				psUB->Used -= iRV;						// decrease total available
+				psUB->IdxRD += iRV;						// advance by what was accepted, full or partial
+				psUB->IdxRD %= psUB->Size;				// wraps to 0 ONLY if this block fully drained
+			}
+		}
+		// Check 2: anything (left) at start of circular buffer? ONLY once Check 1 wrapped, else the
+		// unsent tail of the [IdxRD,Size) block is still pending and pBuf[0] is not the read point.
+		if ((iRV >= 0) && psUB->Used && (psUB->IdxRD == 0) && (Total < Max)) {
+			ssize_t Now = psUB->Used;
+			if (Now > (Max - Total))
+				Now = Max - Total;
+			iRV = hdlr(psUB->pBuf, Now);
+			if (iRV > 0) {
+				vUBufDigest(psUB, bufDIG_DRAIN, psUB->pBuf, iRV);
+				Total += iRV;
+				psUB->Used -= iRV;
 				psUB->IdxRD += iRV;						// partial, more to send on the next pass
+			}
 		}
+		if (psUB->Used == 0)
+			psUB->IdxRD = psUB->IdxWR = 0;				// fully drained, safe to reset both
 	}
 	xUBufUnLock(psUB);
 	return (iRV < erSUCCESS) ? iRV : Total;
 }
 
+int xUBufEmptyBlock(ubuf_t * psUB, int (*hdlr)(const void *, size_t)) {
+	return xUBufEmptyLimit(psUB, hdlr, 0);
+}
+
+void vUBufChainInit(ubuf_chain_t * psC, int (*hdlr)(const void *, size_t)) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psC) && (hdlr != NULL));
+	psC->hdlr = hdlr;
+	psC->Stages = 0;
+}
+
+int xUBufChainAdd(ubuf_chain_t * psC, ubuf_xform_t xform, void * pvCtx) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psC) && (xform != NULL));
+	if (psC->Stages == ubufFILT_MAX) {
+		errno = ENOSPC;
+		return erFAILURE;
+	}
+	psC->sFilt[psC->Stages++] = (ubuf_filt_t) { .xform = xform, .pvCtx = pvCtx };
+	return erSUCCESS;
+}
+
+size_t xUBufChainPending(ubuf_chain_t * psC) {
+	size_t Pend = 0;
+	for (int i = 0; i < psC->Stages; ++i)
+		Pend += psC->sFilt[i].WR - psC->sFilt[i].RD;
+	return Pend;
+}
+
+int xUBufEmptyChain(ubuf_t * psUB, ubuf_chain_t * psC, size_t Max) {
+	IF_myASSERT(debugPARAM, halMemoryRAM(psUB) && halMemorySRAM(psC));
+	if (psC->Stages == 0)
+		return xUBufEmptyLimit(psUB, psC->hdlr, Max);
+	if (Max == 0)
+		Max = xUBufGetUsed(psUB);						// no limit, everything buffered now
+	ssize_t Total = 0;
+	size_t Used;
+	xUBufLock(psUB);
+	int iRV = xUBufChainFeed(psC, NULL, 0, &Used);		// what the sink did not accept last time
+	// spilled data is older than anything in RAM, hence MUST go first
+	while ((iRV >= 0) && xUBufSpillUsed(psUB) && (Total < Max)) {
+		u8_t caBuf[ubufSPILL_XFER];
+		size_t Now = Max - Total;
+		if (Now > sizeof(caBuf))
+			Now = sizeof(caBuf);
+		ssize_t sRV = xUBufSpillPeek(psUB->psSpill, caBuf, Now);
+		if (sRV <= 0) {
+			iRV = erFAILURE;
+			break;
+		}
+		iRV = xUBufChainFeed(psC, caBuf, sRV, &Used);
+		vUBufDigest(psUB, bufDIG_DRAIN, caBuf, Used);
+		vUBufSpillStep(psUB->psSpill, Used);
+		Total += Used;
+		if (Used < sRV)									// chain full
+			break;
+	}
+	// then RAM, the [IdxRD,Size) segment followed by the wrapped one, both fed in place
+	while ((iRV >= 0) && psUB->Used && (Total < Max) && (xUBufSpillUsed(psUB) == 0)) {
+		size_t Now = psUB->Size - psUB->IdxRD;
+		if (Now > psUB->Used)
+			Now = psUB->Used;
+		if (Now > (Max - Total))
+			Now = Max - Total;
+		iRV = xUBufChainFeed(psC, psUB->pBuf + psUB->IdxRD, Now, &Used);
+		vUBufDigest(psUB, bufDIG_DRAIN, psUB->pBuf + psUB->IdxRD, Used);
+		Total += Used;
+		psUB->Used -= Used;
+		psUB->IdxRD += Used;
+		psUB->IdxRD %= psUB->Size;
+		if (Used < Now)									// chain full
+			break;
+	}
+	if (psUB->Used == 0)
+		psUB->IdxRD = psUB->IdxWR = 0;					// fully drained, safe to reset both
+	xUBufUnLock(psUB);
+	return (iRV < erSUCCESS) ? iRV : Total;
+}
+
+size_t xUBufXformCRLF(ubuf_filt_t * psF, const u8_t * pIn, size_t Len, size_t * pUsed, u8_t * pOut, size_t Max) {
+	size_t i = 0, o = 0;
+	for (; i < Len; ++i) {
+		u8_t cChr = pIn[i];
+		size_t Need = ((cChr == CHR_LF) && (psF->State == 0)) ? 2 : 1;
+		if ((o + Need) > Max)
+			break;
+		if (Need == 2)
+			pOut[o++] = CHR_CR;
+		pOut[o++] = cChr;
+		psF->State = (cChr == CHR_CR);					// CR/LF already, pass as is
+	}
+	*pUsed = i;
+	return o;
+}
+
+size_t xUBufXformANSI(ubuf_filt_t * psF, const u8_t * pIn, size_t Len, size_t * pUsed, u8_t * pOut, size_t Max) {
+	size_t i = 0, o = 0;
+	for (; (i < Len) && (o < Max); ++i) {
+		u8_t cChr = pIn[i];
+		if (psF->State == 0) {							// normal text
+			if (cChr == CHR_ESC)
+				psF->State = 1;
+			else
+				pOut[o++] = cChr;
+		} else if (psF->State == 1) {					// ESC seen, CSI or 2 byte sequence
+			psF->State = (cChr == '[') ? 2 : 0;
+		} else if (INRANGE(0x40, cChr, 0x7E)) {			// CSI final byte
+			psF->State = 0;
+		}
+	}
+	*pUsed = i;
+	return o;
+}
+
+size_t xUBufXformIAC(ubuf_filt_t * psF, const u8_t * pIn, size_t Len, size_t * pUsed, u8_t * pOut, size_t Max) {
+	size_t i = 0, o = 0;
+	for (; i < Len; ++i) {
+		size_t Need = (pIn[i] == 0xFF) ? 2 : 1;
+		if ((o + Need) > Max)
+			break;
+		if (Need == 2)
+			pOut[o++] = 0xFF;
+		pOut[o++] = pIn[i];
+	}
+	*pUsed = i;
+	return o;
+}
+
+size_t xUBufXformHex(ubuf_filt_t * psF, const u8_t * pIn, size_t Len, size_t * pUsed, u8_t * pOut, size_t Max) {
+	static const char caHex[] = "0123456789ABCDEF";
+	size_t i = 0, o = 0;
+	for (; (i < Len) && ((o + 2) <= Max); ++i) {
+		pOut[o++] = caHex[pIn[i] >> 4];
+		pOut[o++] = caHex[pIn[i] & 0x0F];
+	}
+	*pUsed = i;
+	return o;
+}
+
 ssize_t xUBufRead(ubuf_t * psUB, const void * pBuf, size_t Size) {
-	if (psUB->pBuf == NULL || Size == 0)
+	if ((psUB->pBuf == NULL && psUB->f_reclaim == 0) || Size == 0)
 		return erINV_PARA;
 	ssize_t	sRV = xUBufCheckAvail(psUB);
 	if (sRV != erSUCCESS)
 		return sRV;
+	const void * pStart = pBuf;
 	xUBufLock(psUB);
-	while((psUB->Used > 0) && (sRV < Size)) {
+	while ((sRV < Size) && xUBufSpillUsed(psUB)) {		// older spilled data MUST be read first
+		ssize_t Now = xUBufSpillPeek(psUB->psSpill, (void *) pBuf, Size - sRV);
+		if (Now <= 0) {
+			if (sRV == 0) {
+				xUBufUnLock(psUB);
+				return Now;
+			}
+			break;
+		}
+		vUBufSpillStep(psUB->psSpill, Now);
+		pBuf += Now;
+		sRV += Now;
+	}
+	while((psUB->Used > 0) && (sRV < Size) && (xUBufSpillUsed(psUB) == 0)) {	// RAM is newer
 		*(char *)pBuf++ = psUB->pBuf[psUB->IdxRD++];	// read from circular to supplied buffer, adjust pointer
 		++sRV;											// adjust read count
 		if (--psUB->Used == 0)							// if nothing left to read
@@ -179,6 +852,7 @@ ssize_t xUBufRead(ubuf_t * psUB, const void * pBuf, size_t Size) {
 		else 
 			psUB->IdxRD %= psUB->Size;					// handle wrap
 	}
+	vUBufDigest(psUB, bufDIG_DRAIN, pStart, sRV);		// just copied, still in cache
 	xUBufUnLock(psUB);
 	return sRV;
 }
@@ -199,64 +873,515 @@ char * pcUBufGetS(char * pBuf, int Number, ubuf_t * psUB) {
 			*pTmp = 0;				// indicate so...
 			return NULL;
 		}
-		*pTmp++ = cChr;									// store character & adjust pointer
-		--Number;										// update remaining chars to read
+		*pTmp++ = cChr;									// store character & adjust pointer
+		--Number;										// update remaining chars to read
+	}
+	*pTmp = 0;
+	return pBuf;										// and return a valid state
+}
+
+static ssize_t xUBufWriteRing(ubuf_t * psUB, const void * pBuf, size_t Size) {
+	if ((psUB->pBuf == NULL && psUB->f_reclaim == 0) || Size == 0)
+		return erINV_PARA;
+	ssize_t Avail = xUBufBlockSpace(psUB, Size);
+	if (Avail == bufOVF_DROP)
+		return 0;										// discarded by policy, errno set
+	if (Avail < 1)
+		return EOF;
+	xUBufLock(psUB);
+	while (psUB->f_reclaim) {							// storage released while idle
+		xUBufUnLock(psUB);
+		if (xUBufRealloc(psUB) != erSUCCESS)
+			return erFAILURE;
+		xUBufLock(psUB);
+	}
+	/* At most TWO memcpy: IdxWR to the end of the buffer, then the wrap back to the start.
+	 *
+	 * This was a per-byte loop, and IdxWR/Used are volatile u16_t living in sRTCvars, ie in RTC
+	 * SLOW memory (hal_memory.c, RTC_NOINIT_ATTR). Every byte therefore cost a volatile RMW of
+	 * IdxWR, one of Used, and a modulo - about six barriered accesses over the slow RTC bus for
+	 * each single byte stored. Measured at ~7 uS PER BYTE, which was 87% of a staged printfx call.
+	 * Reading each index once and writing it once moves that cost from per-byte to per-call. */
+	ssize_t sFree = psUB->Size - psUB->Used;			// real free space
+	ssize_t sRV = (Avail < sFree) ? Avail : sFree;		// same clamp the old loop condition applied
+	if (sRV > 0) {
+		ubidx_t Was = psUB->Used;
+		ubidx_t Idx = psUB->IdxWR;						// ONE read of the volatile index
+		ssize_t Now = psUB->Size - Idx;					// bytes from IdxWR to end of buffer
+		if (Now > sRV)
+			Now = sRV;
+		memcpy(psUB->pBuf + Idx, pBuf, Now);
+		if (sRV > Now)									// wrapped, remainder goes at the start
+			memcpy(psUB->pBuf, (const char *)pBuf + Now, sRV - Now);
+		vUBufDigest(psUB, bufDIG_WRITE, pBuf, sRV);
+		Idx += sRV;
+		if (Idx >= psUB->Size)							// conditional subtract, not a division
+			Idx -= psUB->Size;
+		psUB->IdxWR = Idx;								// ONE write of the volatile index
+		psUB->Used += sRV;
+		if (psUB->psFlush)
+			vUBufFlushKick(psUB->psFlush, Was, psUB->Used);
+	}
+	xUBufUnLock(psUB);
+	return sRV;
+}
+
+/**
+ * @brief		fill the free segment(s) of the buffer, buffer MUST be locked
+ */
+static size_t xUBufFillLocked(ubuf_t * psUB, size_t Max, size_t (*fill)(void *, u8_t *, size_t), void * pvCtx) {
+	if (psUB->f_reclaim)								// released again since reallocated
+		return 0;
+	size_t Free = psUB->Size - psUB->Used;
+	if ((Max == 0) || (Max > Free))
+		Max = Free;
+	ubidx_t Was = psUB->Used;
+	size_t Total = 0;
+	while (Total < Max) {								// at most twice, up to the end then from the start
+		size_t Now = psUB->Size - psUB->IdxWR;
+		if (Now > (Max - Total))
+			Now = Max - Total;
+		size_t Done = fill(pvCtx, psUB->pBuf + psUB->IdxWR, Now);
+		vUBufDigest(psUB, bufDIG_WRITE, psUB->pBuf + psUB->IdxWR, Done);
+		ubidx_t Idx = psUB->IdxWR + Done;
+		psUB->IdxWR = (Idx >= psUB->Size) ? (Idx - psUB->Size) : Idx;
+		psUB->Used += Done;
+		Total += Done;
+		if (Done < Now)									// source exhausted
+			break;
+	}
+	if (Total && psUB->psFlush)
+		vUBufFlushKick(psUB->psFlush, Was, psUB->Used);
+	return Total;
+}
+
+/**
+ * @brief		fill handler taking data from a source ubuf_t, both buffers MUST be locked
+ */
+static size_t xUBufTake(void * pvCtx, u8_t * pDst, size_t Len) {
+	ubuf_t * psUB = pvCtx;
+	size_t Done = 0;
+	while ((Done < Len) && xUBufSpillUsed(psUB)) {		// oldest first, read straight into pDst
+		ssize_t sRV = xUBufSpillPeek(psUB->psSpill, pDst + Done, Len - Done);
+		if (sRV <= 0)
+			return Done;
+		vUBufDigest(psUB, bufDIG_DRAIN, pDst + Done, sRV);
+		vUBufSpillStep(psUB->psSpill, sRV);
+		Done += sRV;
+	}
+	while ((Done < Len) && psUB->Used) {				// at most twice, up to the end then from the start
+		size_t Now = psUB->Size - psUB->IdxRD;
+		if (Now > psUB->Used)
+			Now = psUB->Used;
+		if (Now > (Len - Done))
+			Now = Len - Done;
+		memcpy(pDst + Done, psUB->pBuf + psUB->IdxRD, Now);
+		vUBufDigest(psUB, bufDIG_DRAIN, pDst + Done, Now);
+		psUB->IdxRD = (psUB->IdxRD + Now) % psUB->Size;
+		psUB->Used -= Now;
+		Done += Now;
+	}
+	if (psUB->Used == 0)
+		psUB->IdxRD = psUB->IdxWR = 0;
+	return Done;
+}
+
+/**
+ * @brief		continue a 32 bit FNV-1a hash over Len bytes
+ */
+static u32_t xUBufDedupHash(u32_t Hash, const u8_t * pu8, size_t Len) {
+	while (Len--) {
+		Hash ^= *pu8++;
+		Hash *= ubufFNV_PRIME;
+	}
+	return Hash;
+}
+
+/**
+ * @brief		write the repeat count of the current run, if any, dedup MUST be locked
+ */
+static void vUBufDedupReport(ubuf_t * psUB, ubuf_dedup_t * psD) {
+	if (psD->Count == 0)
+		return;
+	char caBuf[48];
+	int Len = snprintf(caBuf, sizeof(caBuf), "last message repeated %lu times" strNL, psD->Count);
+	xUBufWriteRing(psUB, caBuf, Len);
+	psD->Total += psD->Count;
+	psD->Count = 0;
+}
+
+/**
+ * @brief		write the assembled partial line as is, dedup MUST be locked
+ */
+static void vUBufDedupPass(ubuf_t * psUB, ubuf_dedup_t * psD) {
+	vUBufDedupReport(psUB, psD);
+	if (psD->Len)
+		xUBufWriteRing(psUB, psD->caLine, psD->Len);
+	psD->Len = 0;
+	psD->Hash = ubufFNV_SEED;
+	psD->LastLen = 0;									// cannot be compared against
+}
+
+/**
+ * @brief		a complete line has been assembled, count it if a repeat else write it
+ */
+static void vUBufDedupLine(ubuf_t * psUB, ubuf_dedup_t * psD) {
+	if ((psD->Len == psD->LastLen) && (psD->Hash == psD->LastHash)) {
+		TickType_t tNow = xTaskGetTickCount();
+		if (++psD->Count == 1)
+			psD->tFirst = tNow;
+		else if (psD->msLimit && ((tNow - psD->tFirst) >= pdMS_TO_TICKS(psD->msLimit)))
+			vUBufDedupReport(psUB, psD);				// long run, report progress
+	} else {
+		vUBufDedupReport(psUB, psD);					// run (if any) ended
+		xUBufWriteRing(psUB, psD->caLine, psD->Len);
+		psD->LastHash = psD->Hash;
+		psD->LastLen = psD->Len;
+	}
+	psD->Len = 0;
+	psD->Hash = ubufFNV_SEED;
+}
+
+/**
+ * @brief		assemble writes into lines, suppressing repeats of the last line written
+ * @return		Size, all bytes are accepted into the line or passed to the buffer
+ */
+static ssize_t xUBufDedupWrite(ubuf_t * psUB, const void * pBuf, size_t Size) {
+	ubuf_dedup_t * psD = psUB->psDedup;
+	const u8_t * pu8 = pBuf;
+	size_t Left = Size;
+	xRtosSemaphoreTake(&psD->mux, portMAX_DELAY);
+	while (Left) {
+		const u8_t * pLF = memchr(pu8, CHR_LF, Left);
+		size_t Now = pLF ? (pLF - pu8 + 1) : Left;
+		if (!psD->f_long && ((psD->Len + Now) > sizeof(psD->caLine))) {
+			vUBufDedupPass(psUB, psD);					// too long to check, pass through
+			psD->f_long = 1;
+		}
+		if (psD->f_long) {
+			xUBufWriteRing(psUB, pu8, Now);
+			if (pLF)
+				psD->f_long = 0;						// next line checked again
+		} else {
+			memcpy(psD->caLine + psD->Len, pu8, Now);
+			psD->Len += Now;
+			psD->Hash = xUBufDedupHash(psD->Hash, pu8, Now);
+			if (pLF)
+				vUBufDedupLine(psUB, psD);
+		}
+		pu8 += Now;
+		Left -= Now;
+	}
+	xRtosSemaphoreGive(&psD->mux);
+	return Size;
+}
+
+/**
+ * @brief		write past the staging layer, via the dedup stage if enabled
+ */
+static ssize_t xUBufWriteDeliver(ubuf_t * psUB, const void * pBuf, size_t Size) {
+	if (psUB->psDedup && Size && (psUB->pBuf || psUB->f_reclaim))
+		return xUBufDedupWrite(psUB, pBuf, Size);
+	return xUBufWriteRing(psUB, pBuf, Size);
+}
+
+/**
+ * @brief		write all staged bytes to their buffer and empty the stage
+ */
+static void vUBufStageEmpty(ubuf_stage_t * psS) {
+	if (psS->Len && psS->psUB)
+		xUBufWriteDeliver(psS->psUB, psS->Buf, psS->Len);
+	psS->Len = 0;
+}
+
+/**
+ * @brief		claim a stage, owner and drainer exclude each other without a mutex
+ */
+static bool bUBufStageClaim(ubuf_stage_t * psS) {
+	u8_t Free = 0;
+	return __atomic_compare_exchange_n(&psS->Busy, &Free, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void vUBufStageClaim(ubuf_stage_t * psS) {
+	while (bUBufStageClaim(psS) == false)				// only contended while a drainer writes it out
+		vBufOvfDelay();
+}
+
+static void vUBufStageRelease(ubuf_stage_t * psS) { __atomic_store_n(&psS->Busy, 0, __ATOMIC_RELEASE); }
+
+/**
+ * @brief		write out own stage if it holds bytes for a buffer no longer staged
+ */
+static void vUBufStageCatchUp(ubuf_t * psUB) {
+	ubuf_stage_t * psS = pvTaskGetThreadLocalStoragePointer(NULL, ubufSTAGE_TLS);
+	if (psS && psS->Len && (psS->psUB == psUB)) {		// a drainer might be busy with it
+		vUBufStageClaim(psS);
+		if (psS->psUB == psUB)
+			vUBufStageEmpty(psS);
+		vUBufStageRelease(psS);
+	}
+}
+
+/**
+ * @brief		unlink and free stages of deleted tasks, list mutex MUST be held
+ */
+static void vUBufStageReap(void) {
+	for (ubuf_stage_t ** ppS = &psUBufStages; *ppS; ) {
+		ubuf_stage_t * psS = *ppS;
+		if (psS->f_dead && (psS->Busy == 0)) {
+			*ppS = psS->psNext;
+			vBFreeType(NULL, ballocTYPE_UBUF, psS, sizeof(ubuf_stage_t));
+		} else {
+			ppS = &psS->psNext;
+		}
+	}
+}
+
+static size_t xUBufCopyFill(void * pvCtx, u8_t * pDst, size_t Len) {
+	u8_t ** ppSrc = pvCtx;
+	memcpy(pDst, *ppSrc, Len);
+	*ppSrc += Len;
+	return Len;
+}
+
+/**
+ * @brief		TLS delete callback, runs in the idle or the deleting task so MUST NOT block
+ * @note		stage stays listed (freed by a later list walk) as the list mutex is not taken here
+ */
+static void vUBufStageDelete(int Idx, void * pv) {
+	ubuf_stage_t * psS = pv;
+	if (bUBufStageClaim(psS)) {							// else a drainer is writing it out
+		ubuf_t * psUB = psS->psUB;
+		if (psS->Len && psUB && (psUB->psDedup == NULL) && (psUB->f_nolock == 0) && bUBufTryLock(psUB)) {
+			u8_t * pSrc = psS->Buf;
+			if ((psUB->Size - psUB->Used) >= psS->Len)
+				xUBufFillLocked(psUB, psS->Len, xUBufCopyFill, &pSrc);
+			xUBufUnLock(psUB);
+		}
+		psS->Len = 0;
+		vUBufStageRelease(psS);
+	}
+	__atomic_store_n(&psS->f_dead, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief		stage of the calling task, created on first use
+ * @return		pointer to stage or NULL if it could not be allocated
+ */
+static ubuf_stage_t * psUBufStageGet(void) {
+	ubuf_stage_t * psS = pvTaskGetThreadLocalStoragePointer(NULL, ubufSTAGE_TLS);
+	if (psS == NULL) {
+		psS = pvBAllocType(NULL, ballocTYPE_UBUF, sizeof(ubuf_stage_t), ballocCAP_DEFAULT);
+		if (psS == NULL)
+			return NULL;
+		psS->psUB = NULL;
+		psS->Len = 0;
+		psS->Busy = psS->f_dead = 0;
+		xRtosSemaphoreTake(&muxUBufStage, portMAX_DELAY);
+		vUBufStageReap();
+		psS->psNext = psUBufStages;
+		psUBufStages = psS;
+		xRtosSemaphoreGive(&muxUBufStage);
+		vTaskSetThreadLocalStoragePointerAndDelCallback(NULL, ubufSTAGE_TLS, psS, vUBufStageDelete);
+	}
+	return psS;
+}
+
+/**
+ * @brief		gather fragments in the task's stage, write out up to the last LF or when full
+ * @return		Size, errors writing out the stage are not reported to the writer
+ */
+static ssize_t xUBufStageWrite(ubuf_t * psUB, const void * pBuf, size_t Size) {
+	ubuf_stage_t * psS = psUBufStageGet();
+	if (psS == NULL)
+		return xUBufWriteDeliver(psUB, pBuf, Size);		// no memory, write unstaged
+	vUBufStageClaim(psS);
+	if (psUB->f_stage == 0) {							// disabled since checked, claim orders the re-check
+		if (psS->psUB == psUB) {						// drainer not here yet, own bytes first
+			vUBufStageEmpty(psS);
+			psS->psUB = NULL;
+		}
+		vUBufStageRelease(psS);
+		return xUBufWriteDeliver(psUB, pBuf, Size);
+	}
+	if (psS->psUB != psUB) {							// other buffer, keep order per buffer
+		vUBufStageEmpty(psS);
+		psS->psUB = psUB;
+	}
+	if ((psS->Len + Size) > sizeof(psS->Buf)) {			// does not fit
+		vUBufStageEmpty(psS);
+		if (Size >= sizeof(psS->Buf)) {					// large, nothing gained by staging
+			vUBufStageRelease(psS);
+			return xUBufWriteDeliver(psUB, pBuf, Size);
+		}
+	}
+	memcpy(psS->Buf + psS->Len, pBuf, Size);
+	psS->Len += Size;
+	size_t Line = psS->Len;
+	while (Line > (psS->Len - Size) && (psS->Buf[Line - 1] != CHR_LF))
+		--Line;											// find the last LF just added
+	if (Line > (psS->Len - Size)) {
+		xUBufWriteDeliver(psUB, psS->Buf, Line);		// complete line(s) in one copy
+		psS->Len -= Line;
+		memmove(psS->Buf, psS->Buf + Line, psS->Len);
+	}
+	vUBufStageRelease(psS);
+	return Size;
+}
+
+ssize_t xUBufWrite(ubuf_t * psUB, const void * pBuf, size_t Size) {
+	if (!xPortInIsrContext() && (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)) {
+		if (psUB->f_stage && Size && (psUB->pBuf || psUB->f_reclaim))
+			return xUBufStageWrite(psUB, pBuf, Size);
+		vUBufStageCatchUp(psUB);						// staging just disabled, own bytes first
+	}
+	return xUBufWriteDeliver(psUB, pBuf, Size);
+}
+
+int	xUBufPutC(ubuf_t * psUB, int iChr) {
+ 	u8_t u8Chr = (u8_t)iChr;
+	int iRV = xUBufWrite(psUB, &u8Chr, sizeof(u8Chr));
+	return (iRV == sizeof(u8Chr)) ? iChr : EOF;			// also if dropped by policy
+}
+
+/**
+ * @brief		compare pattern with buffered data at offset, handles wrap. Buffer MUST be locked
+ */
+static bool bUBufMatch(ubuf_t * psUB, size_t Off, const u8_t * pu8Pat, size_t Len) {
+	size_t Idx = (psUB->IdxRD + Off) % psUB->Size;
+	size_t Now = psUB->Size - Idx;						// bytes before the wrap
+	if (Now > Len)
+		Now = Len;
+	return (memcmp(psUB->pBuf + Idx, pu8Pat, Now) == 0) &&
+			((Now == Len) || (memcmp(psUB->pBuf, pu8Pat + Now, Len - Now) == 0));
+}
+
+ssize_t xUBufFind(ubuf_t * psUB, const void * pvPat, size_t Len, size_t Start) {
+	IF_myASSERT(debugPARAM, halMemoryRAM(psUB) && (pvPat != NULL));
+	const u8_t * pu8Pat = pvPat;
+	ssize_t sRV = erFAILURE;
+	if ((Len == 0) || (psUB->pBuf == NULL))
+		return sRV;
+	xUBufLockRO(psUB);
+	size_t Skip = xUBufSpillUsed(psUB);					// spilled data is in front, NOT searched
+	size_t Off = (Start > Skip) ? (Start - Skip) : 0;
+	size_t Used = psUB->Used;
+	if ((Off + Len) <= Used) {
+		size_t Seg1 = psUB->Size - psUB->IdxRD;			// bytes from IdxRD to end of buffer
+		if (Seg1 > Used)
+			Seg1 = Used;								// not wrapped
+		size_t Last = Used - Len;						// last offset at which a match can start
+		while (Off <= Last) {
+			// memchr() for the first byte within the segment holding Off, then compare the rest
+			const u8_t * pu8Seg = (Off < Seg1) ? (psUB->pBuf + psUB->IdxRD) : psUB->pBuf;
+			size_t Base = (Off < Seg1) ? 0 : Seg1;		// offset of the segment start
+			size_t Lim = ((Off < Seg1) ? Seg1 : Used) - Base;
+			if (Lim > (Last - Base + 1))
+				Lim = Last - Base + 1;					// no point looking beyond Last
+			const u8_t * pu8Now = memchr(pu8Seg + (Off - Base), *pu8Pat, Lim - (Off - Base));
+			if (pu8Now == NULL) {
+				if ((Base == 0) && (Seg1 <= Last)) {	// continue in the wrapped segment
+					Off = Seg1;
+					continue;
+				}
+				break;
+			}
+			Off = Base + (pu8Now - pu8Seg);
+			if (bUBufMatch(psUB, Off, pu8Pat, Len)) {
+				sRV = Off + Skip;
+				break;
+			}
+			++Off;
+		}
 	}
-	*pTmp = 0;
-	return pBuf;										// and return a valid state
+	xUBufUnLockRO(psUB);
+	return sRV;
 }
 
-ssize_t xUBufWrite(ubuf_t * psUB, const void * pBuf, size_t Size) {
-	if (psUB->pBuf == NULL || Size == 0)
+ssize_t xUBufSnapshot(ubuf_t * psUB, void * pvBuf, size_t Size) {
+	IF_myASSERT(debugPARAM, halMemoryRAM(psUB) && (pvBuf != NULL));
+	for (int Try = 0; Try < ubufSNAP_RETRY; ++Try) {
+		u32_t Seq = __atomic_load_n(&psUB->Seq, __ATOMIC_ACQUIRE);
+		if (Seq & 1) {									// being modified, give the writer a chance
+			vBufOvfDelay();
+			continue;
+		}
+		size_t Used = psUB->Used;
+		size_t IdxWR = psUB->IdxWR;
+		size_t Now = (Used < Size) ? Used : Size;		// newest Now bytes end at IdxWR
+		if (Now == 0)
+			return 0;									// empty, storage might be released
+		if (bUBufSnapCopy(psUB, Seq, (IdxWR + psUB->Size - Now) % psUB->Size, pvBuf, Now))
+			return Now;
+	}
+	errno = EAGAIN;
+	return erFAILURE;
+}
+
+u8_t * pcUBufTellRead(ubuf_t * psUB) {
+	xUBufLockRO(psUB);
+	u8_t * pU8 = psUB->pBuf + psUB->IdxRD;
+	xUBufUnLockRO(psUB);
+	return pU8;
+}
+
+ssize_t xUBufWriteFill(ubuf_t * psUB, size_t Max, size_t (*fill)(void *, u8_t *, size_t), void * pvCtx) {
+	IF_myASSERT(debugPARAM, halMemoryRAM(psUB) && (fill != NULL));
+	if (psUB->pBuf == NULL && psUB->f_reclaim == 0)
 		return erINV_PARA;
-	ssize_t Avail = xUBufBlockSpace(psUB, Size);
-	if (Avail < 1)
-		return EOF;
+	if (psUB->f_reclaim && (xUBufRealloc(psUB) != erSUCCESS))
+		return erFAILURE;
 	xUBufLock(psUB);
-	/* At most TWO memcpy: IdxWR to the end of the buffer, then the wrap back to the start.
-	 *
-	 * This was a per-byte loop, and IdxWR/Used are volatile u16_t living in sRTCvars, ie in RTC
-	 * SLOW memory (hal_memory.c, RTC_NOINIT_ATTR). Every byte therefore cost a volatile RMW of
-	 * IdxWR, one of Used, and a modulo - about six barriered accesses over the slow RTC bus for
-	 * each single byte stored. Measured at ~7 uS PER BYTE, which was 87% of a staged printfx call.
-	 * Reading each index once and writing it once moves that cost from per-byte to per-call. */
-	ssize_t sFree = psUB->Size - psUB->Used;			// real free space
-	ssize_t sRV = (Avail < sFree) ? Avail : sFree;		// same clamp the old loop condition applied
-	if (sRV > 0) {
-		u16_t Idx = psUB->IdxWR;						// ONE read of the volatile index
-		ssize_t Now = psUB->Size - Idx;					// bytes from IdxWR to end of buffer
-		if (Now > sRV)
-			Now = sRV;
-		memcpy(psUB->pBuf + Idx, pBuf, Now);
-		if (sRV > Now)									// wrapped, remainder goes at the start
-			memcpy(psUB->pBuf, (const char *)pBuf + Now, sRV - Now);
-		Idx += sRV;
-		if (Idx >= psUB->Size)							// conditional subtract, not a division
-			Idx -= psUB->Size;
-		psUB->IdxWR = Idx;								// ONE write of the volatile index
-		psUB->Used += sRV;
-	}
+	ssize_t sRV = xUBufFillLocked(psUB, Max, fill, pvCtx);
 	xUBufUnLock(psUB);
 	return sRV;
 }
 
-int	xUBufPutC(ubuf_t * psUB, int iChr) {
- 	u8_t u8Chr = (u8_t)iChr;
-	int iRV = xUBufWrite(psUB, &u8Chr, sizeof(u8Chr));
-	return (iRV != sizeof(u8Chr)) ? iRV : iChr;
+ssize_t xUBufSplice(ubuf_t * psDst, ubuf_t * psSrc, size_t Max) {
+	IF_myASSERT(debugPARAM, halMemoryRAM(psDst) && halMemoryRAM(psSrc));
+	if ((psDst == psSrc) || (psDst->pBuf == NULL && psDst->f_reclaim == 0) ||
+		(psSrc->pBuf == NULL && psSrc->f_reclaim == 0)) {
+		errno = EINVAL;
+		return erFAILURE;
+	}
+	if (psDst->f_reclaim && (xUBufRealloc(psDst) != erSUCCESS))
+		return erFAILURE;
+	ubuf_t * psLo = (psDst < psSrc) ? psDst : psSrc;	// fixed order, no deadlock between 2 splicers
+	ubuf_t * psHi = (psDst < psSrc) ? psSrc : psDst;
+	xUBufLock(psLo);
+	xUBufLock(psHi);
+	size_t Avail = psSrc->Used + xUBufSpillUsed(psSrc);
+	if ((Max == 0) || (Max > Avail))
+		Max = Avail;
+	ssize_t sRV = Max ? xUBufFillLocked(psDst, Max, xUBufTake, psSrc) : 0;
+	xUBufUnLock(psHi);
+	xUBufUnLock(psLo);
+	return sRV;
 }
 
-u8_t * pcUBufTellRead(ubuf_t * psUB) {
-	xUBufLock(psUB);
-	u8_t * pU8 = psUB->pBuf + psUB->IdxRD;
-	xUBufUnLock(psUB);
+u8_t * pcUBufPeek(ubuf_t * psUB, size_t * pLen) {
+	u8_t * pU8 = NULL;
+	xUBufLockRO(psUB);
+	if (psUB->pBuf == NULL) {							// storage released while idle, or destroyed
+		*pLen = 0;
+		errno = psUB->f_reclaim ? ENODATA : ENOMEM;
+	} else if (psUB->psSpill) {
+		*pLen = 0;
+		errno = EBUSY;
+	} else {
+		pU8 = psUB->pBuf + psUB->IdxRD;
+		*pLen = (psUB->Used > (psUB->Size - psUB->IdxRD)) ? (psUB->Size - psUB->IdxRD) : psUB->Used;
+	}
+	xUBufUnLockRO(psUB);
 	return pU8;
 }
 
 u8_t * pcUBufTellWrite(ubuf_t * psUB) {
-	xUBufLock(psUB);
+	if (psUB->f_reclaim && (xUBufRealloc(psUB) != erSUCCESS))
+		return NULL;
+	xUBufLockRO(psUB);
 	u8_t * pU8 = psUB->pBuf + psUB->IdxWR;
-	xUBufUnLock(psUB);
+	xUBufUnLockRO(psUB);
 	return pU8;
 }
 
@@ -289,57 +1414,411 @@ void vUBufStepWrite(ubuf_t * psUB, int Step) {
 	xUBufUnLock(psUB);
 }
 
-ubuf_t * psUBufCreate(ubuf_t * psUB, u8_t * pcBuf, size_t BufSize, size_t Used) {
+ubuf_t * psUBufCreateCaps(ubuf_t * psUB, u8_t * pcBuf, size_t BufSize, size_t Used, const balloc_t * psA, u32_t Caps) {
 	IF_myASSERT(debugPARAM, (psUB == NULL) || halMemorySRAM(psUB));
-	IF_myASSERT(debugPARAM, (pcBuf == NULL) || halMemorySRAM(pcBuf));
+	IF_myASSERT(debugPARAM, (pcBuf == NULL) || halMemoryRAM(pcBuf));
 	IF_myASSERT(debugPARAM, !(pcBuf == NULL && Used > 0));
 	IF_myASSERT(debugPARAM, INRANGE(ubufSIZE_MINIMUM, BufSize, ubufSIZE_MAXIMUM) && Used <= BufSize);
+	bool bAlloc = (pcBuf == NULL);
+	if (bAlloc) {										// allocate first, nothing to undo if it fails
+		pcBuf = pvBAllocType(psA, ballocTYPE_UBUF, BufSize, Caps & ~ballocCAP_ZERO);
+		if (pcBuf == NULL)
+			return NULL;
+	}
 	if (psUB != NULL) {									// control structure supplied
 		psUB->f_struct = 0;								// yes, flag as NOT allocated
 	} else {
-		psUB = malloc(sizeof(ubuf_t));					// no, allocate
+		psUB = pvBAllocType(psA, ballocTYPE_UBUF, sizeof(ubuf_t), ballocCAP_DEFAULT);	// no, allocate
+		if (psUB == NULL) {
+			if (bAlloc)
+				vBFreeType(psA, ballocTYPE_UBUF, pcBuf, BufSize);
+			return NULL;
+		}
 		psUB->f_struct = 1;								// and flag as such
 	}
-	if (pcBuf != NULL) {								// buffer itself allocated
-		psUB->pBuf = pcBuf;								// yes, save pointer into control structure
-		psUB->f_alloc = 0;								// and flag as NOT allocated
-	} else {
-		psUB->pBuf = malloc(BufSize);					// no, allocate buffer of desired size
-		psUB->f_alloc = 1;								// and flag as allocated
-	}
+	psUB->pBuf = pcBuf;									// save pointer into control structure
+	psUB->f_alloc = bAlloc;								// flag whether allocated or not
+	psUB->psA = psA;
 	psUB->mux = NULL;
+	psUB->psFlush = NULL;
+	psUB->psOvf = NULL;
+	psUB->psSpill = NULL;
+	psUB->psDedup = NULL;
+	psUB->psDig = NULL;
+	psUB->Seq = 0;
 	psUB->IdxWR = psUB->Used  = Used;
 	psUB->IdxRD = 0;
 	psUB->Size = BufSize;
 	psUB->count = 0;
 	psUB->f_nolock = 0;
 	psUB->f_history = 0;
-	if (Used == 0)
+	psUB->f_stage = 0;
+	psUB->f_reclaim = 0;
+	if ((Used == 0) && (Caps & ballocCAP_ZERO))
 		memset(psUB->pBuf, 0, psUB->Size);				// clear buffer ONLY if nothing to be used
 	psUB->f_init = 1;
 	SL_INFO("A=%p  S=%lu  F=x%02X", psUB->pBuf, psUB->Size, psUB->f_flags);
 	return psUB;
 }
 
+ubuf_t * psUBufCreate(ubuf_t * psUB, u8_t * pcBuf, size_t BufSize, size_t Used) {
+	return psUBufCreateCaps(psUB, pcBuf, BufSize, Used, NULL, ballocCAP_ZERO);
+}
+
+void vUBufSetAllocator(const balloc_t * psA, u32_t Caps) {
+	psUBufAlloc = psA;
+	uBufCaps = Caps;
+}
+
 void vUBufDestroy(ubuf_t * psUB) {
 	IF_myASSERT(debugPARAM, halMemorySRAM(psUB));
 	SL_INFO("A=%p  S=%lu  F=x%02X  M=x%X", psUB->pBuf, psUB->Size, psUB->f_flags, psUB->mux);
+	if (psUB->f_stage)
+		vUBufSetStaged(psUB, false);					// staged bytes in first, no stage may keep pointing here
+	if (psUB->psFlush)
+		vUBufFlushStop(psUB);
+	if (psUB->psSpill)
+		vUBufSpillStop(psUB);
+	if (psUB->psDedup)
+		vUBufDedupStop(psUB);
+	xRtosSemaphoreTake(&muxUBufReg, portMAX_DELAY);	// no longer reclaimable
+	for (int i = 0; i < ubufRECLAIM_MAX; ++i) {
+		if (sUBufReg[i].psUB == psUB)
+			sUBufReg[i].psUB = NULL;
+	}
+	xRtosSemaphoreGive(&muxUBufReg);
 	if (psUB->mux)
 		vRtosSemaphoreDelete(&psUB->mux);
 	if (psUB->f_alloc) {
-		free(psUB->pBuf);
+		vBFreeType(psUB->psA, ballocTYPE_UBUF, psUB->pBuf, psUB->Size);	// NULL if reclaimed
+		psUB->f_reclaim = 0;
 		psUB->f_alloc = 0;
 		psUB->pBuf = NULL;
 		psUB->Size = 0;
 		psUB->f_init = 0;
 	}
 	if (psUB->f_struct)
-		free(psUB);
+		vBFreeType(psUB->psA, ballocTYPE_UBUF, psUB, sizeof(ubuf_t));
+}
+
+int xUBufFlushStart(ubuf_t * psUB, int (*hdlr)(const void *, size_t), size_t HiWater, u16_t msLatency, size_t MaxPass, UBaseType_t Prio) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psUB) && (hdlr != NULL) && (psUB->f_history == 0));
+	if (psUB->psFlush) {
+		errno = EBUSY;
+		return erFAILURE;
+	}
+	ubuf_flush_t * psF = pvBAllocType(psUB->psA, ballocTYPE_UBUF, sizeof(ubuf_flush_t), ballocCAP_DEFAULT);
+	if (psF == NULL) {
+		errno = ENOMEM;
+		return erFAILURE;
+	}
+	psF->psUB = psUB;
+	psF->hdlr = hdlr;
+	psF->xTask = NULL;
+	psF->tFirst = xTaskGetTickCount();
+	psF->HiWater = (HiWater && HiWater <= psUB->Size) ? HiWater : psUB->Size;
+	psF->msLatency = msLatency;
+	psF->MaxPass = (MaxPass < psUB->Size) ? MaxPass : 0;
+	psF->f_run = 1;
+	if (xTaskCreate(vUBufFlushTask, "ubflush", ubufFLUSH_STACK, psF, Prio, &psF->xTask) != pdPASS) {
+		vBFreeType(psUB->psA, ballocTYPE_UBUF, psF, sizeof(ubuf_flush_t));
+		errno = ENOMEM;
+		return erFAILURE;
+	}
+	xUBufLockRO(psUB);
+	psUB->psFlush = psF;
+	xUBufUnLockRO(psUB);
+	xTaskNotifyGive(psF->xTask);						// pick up anything already buffered
+	return erSUCCESS;
+}
+
+void vUBufFlushStop(ubuf_t * psUB) {
+	xUBufLockRO(psUB);
+	ubuf_flush_t * psF = psUB->psFlush;
+	psUB->psFlush = NULL;								// writers no longer kick the task
+	xUBufUnLockRO(psUB);
+	if (psF == NULL)
+		return;
+	psF->f_run = 0;
+	xTaskNotifyGive(psF->xTask);						// notification is latched, once is enough
+	while (psF->xTask)									// wait for task to exit its loop
+		vBufOvfDelay();
+	vBFreeType(psUB->psA, ballocTYPE_UBUF, psF, sizeof(ubuf_flush_t));
+}
+
+void vUBufSetPolicy(ubuf_t * psUB, bufovf_t * psO) {
+	IF_myASSERT(debugPARAM, (psUB->f_history == 0) && ((psO == NULL) || (psO->Policy < bufPOLICY_NUMBER)));
+	xUBufLockRO(psUB);
+	psUB->psOvf = psO;
+	xUBufUnLockRO(psUB);
+}
+
+void vUBufSetDigest(ubuf_t * psUB, bufdig_t * psD) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psUB) && ((psD == NULL) || (psD->fn != NULL)));
+	xUBufLockRO(psUB);
+	psUB->psDig = psD;
+	xUBufUnLockRO(psUB);
+}
+
+int xUBufSpillStart(ubuf_t * psUB, const char * pcPath, size_t Chunk, size_t Max) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psUB) && (pcPath != NULL) && (psUB->f_history == 0));
+	if (psUB->psSpill) {
+		errno = EBUSY;
+		return erFAILURE;
+	}
+	size_t Len = strlen(pcPath) + 1;
+	Chunk = (Chunk && (Chunk <= psUB->Size)) ? Chunk : (psUB->Size / 4);
+	ubuf_spill_t * psS = pvBAllocType(psUB->psA, ballocTYPE_UBUF, sizeof(ubuf_spill_t) + Len + Chunk, ballocCAP_DEFAULT);	// path then transfer buffer
+	if (psS == NULL) {
+		errno = ENOMEM;
+		return erFAILURE;
+	}
+	psS->fd = open(pcPath, O_RDWR | O_CREAT | O_TRUNC, 0666);
+	if (psS->fd < 0) {
+		vBFreeType(psUB->psA, ballocTYPE_UBUF, psS, sizeof(ubuf_spill_t) + Len + Chunk);
+		return erFAILURE;								// errno set by open()
+	}
+	memcpy(psS->caPath, pcPath, Len);
+	psS->psZ = NULL;
+	psS->mux = NULL;
+	psS->pXfer = (u8_t *) psS->caPath + Len;
+	psS->OffRD = psS->OffWR = psS->OffOK = psS->Total = psS->Lost = 0;
+	psS->Max = Max;
+	psS->Chunk = Chunk;
+	xUBufLockRO(psUB);
+	psUB->psSpill = psS;
+	xUBufUnLockRO(psUB);
+	return erSUCCESS;
+}
+
+void vUBufSpillStop(ubuf_t * psUB) {
+	ubuf_spill_t * psS;
+	while (true) {
+		xUBufLockRO(psUB);
+		psS = psUB->psSpill;
+		if ((psS == NULL) || (psS->OffOK == psS->OffWR))
+			break;
+		xUBufUnLockRO(psUB);							// chunk in flight, let it complete
+		vBufOvfDelay();
+	}
+	psUB->psSpill = NULL;
+	xUBufUnLockRO(psUB);
+	if (psS == NULL)
+		return;
+	size_t Size = sizeof(ubuf_spill_t) + 1;
+	if (psS->psZ) {
+		vBFreeType(psUB->psA, ballocTYPE_UBUF, psS->psZ, ubufZIP_ALLOC(psS->psZ->Block, psS->psZ->Size));
+	} else {
+		xRtosSemaphoreTake(&psS->mux, portMAX_DELAY);	// writer might still be releasing it
+		xRtosSemaphoreGive(&psS->mux);
+		vRtosSemaphoreDelete(&psS->mux);
+		close(psS->fd);
+		unlink(psS->caPath);
+		Size = sizeof(ubuf_spill_t) + strlen(psS->caPath) + 1 + psS->Chunk;	// as allocated
+	}
+	vBFreeType(psUB->psA, ballocTYPE_UBUF, psS, Size);
+}
+
+int xUBufZipStart(ubuf_t * psUB, size_t Block, size_t Arena) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psUB) && (psUB->f_history == 0));
+	if (Block == 0 || Block > psUB->Size)
+		Block = psUB->Size / 4;
+	if (Block > blzMAX_BLOCK)
+		Block = blzMAX_BLOCK;
+	if (Arena < (2 * ((2 * sizeof(u16_t)) + Block))) {
+		errno = EINVAL;
+		return erFAILURE;
+	}
+	if (psUB->psSpill) {
+		errno = EBUSY;
+		return erFAILURE;
+	}
+	ubuf_spill_t * psS = pvBAllocType(psUB->psA, ballocTYPE_UBUF, sizeof(ubuf_spill_t) + 1, ballocCAP_DEFAULT);
+	if (psS == NULL) {
+		errno = ENOMEM;
+		return erFAILURE;
+	}
+	// single allocation, hash table first to keep it aligned
+	ubuf_zip_t * psZ = pvBAllocType(psUB->psA, ballocTYPE_UBUF, ubufZIP_ALLOC(Block, Arena), ballocCAP_DEFAULT);
+	if (psZ == NULL) {
+		vBFreeType(psUB->psA, ballocTYPE_UBUF, psS, sizeof(ubuf_spill_t) + 1);
+		errno = ENOMEM;
+		return erFAILURE;
+	}
+	psZ->pHash = (u16_t *) (psZ + 1);
+	psZ->pRaw = (u8_t *) psZ->pHash + blzHASH_SIZE;
+	psZ->pArena = psZ->pRaw + Block;
+	psZ->Size = Arena;
+	psZ->OffHD = psZ->OffTL = psZ->Used = psZ->Lost = 0;
+	psZ->Block = Block;
+	psZ->RawLen = psZ->RawOff = 0;
+	psS->fd = -1;
+	psS->psZ = psZ;
+	psS->caPath[0] = CHR_NUL;
+	psS->mux = NULL;
+	psS->pXfer = NULL;
+	psS->OffRD = psS->OffWR = psS->OffOK = psS->Total = psS->Lost = 0;
+	psS->Max = 0;
+	psS->Chunk = Block;									// compress whole blocks where possible
+	xUBufLockRO(psUB);
+	psUB->psSpill = psS;
+	xUBufUnLockRO(psUB);
+	return erSUCCESS;
+}
+
+int xUBufDedupStart(ubuf_t * psUB, u16_t msLimit) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psUB) && (psUB->f_history == 0));
+	if (psUB->psDedup) {
+		errno = EBUSY;
+		return erFAILURE;
+	}
+	ubuf_dedup_t * psD = pvBAllocType(psUB->psA, ballocTYPE_UBUF, sizeof(ubuf_dedup_t), ballocCAP_ZERO);
+	if (psD == NULL) {
+		errno = ENOMEM;
+		return erFAILURE;
+	}
+	psD->Hash = ubufFNV_SEED;
+	psD->msLimit = msLimit;
+	xUBufLockRO(psUB);
+	psUB->psDedup = psD;
+	xUBufUnLockRO(psUB);
+	return erSUCCESS;
+}
+
+void vUBufDedupFlush(ubuf_t * psUB) {
+	ubuf_dedup_t * psD = psUB->psDedup;
+	if (psD == NULL)
+		return;
+	xRtosSemaphoreTake(&psD->mux, portMAX_DELAY);
+	if (psD->Len) {
+		vUBufDedupPass(psUB, psD);
+		psD->f_long = 1;								// rest of this line passes through
+	} else {
+		vUBufDedupReport(psUB, psD);
+	}
+	xRtosSemaphoreGive(&psD->mux);
+}
+
+void vUBufDedupStop(ubuf_t * psUB) {
+	vUBufDedupFlush(psUB);
+	xUBufLockRO(psUB);
+	ubuf_dedup_t * psD = psUB->psDedup;
+	psUB->psDedup = NULL;
+	xUBufUnLockRO(psUB);
+	if (psD == NULL)
+		return;
+	if (psD->mux)
+		vRtosSemaphoreDelete(&psD->mux);
+	vBFreeType(psUB->psA, ballocTYPE_UBUF, psD, sizeof(ubuf_dedup_t));
+}
+
+void vUBufSetStaged(ubuf_t * psUB, bool bStaged) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psUB));
+	xRtosSemaphoreTake(&muxUBufStage, portMAX_DELAY);	// no new stages while walking
+	xUBufLockRO(psUB);									// flag shares a word with the others
+	psUB->f_stage = bStaged;
+	xUBufUnLockRO(psUB);
+	if (bStaged == false) {
+		vUBufStageReap();
+		// claim EVERY stage, also empty ones: a writer that saw f_stage set may be about to
+		// claim its stage, once it does it re-checks f_stage and writes past the stage
+		for (ubuf_stage_t * psS = psUBufStages; psS; psS = psS->psNext) {
+			vUBufStageClaim(psS);
+			if (psS->psUB == psUB) {
+				vUBufStageEmpty(psS);
+				psS->psUB = NULL;						// no stage keeps pointing here
+			}
+			vUBufStageRelease(psS);
+		}
+	}
+	xRtosSemaphoreGive(&muxUBufStage);
+}
+
+void vUBufStageFlush(void) {
+	if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+		return;
+	ubuf_stage_t * psS = pvTaskGetThreadLocalStoragePointer(NULL, ubufSTAGE_TLS);
+	if (psS) {
+		vUBufStageClaim(psS);
+		vUBufStageEmpty(psS);
+		vUBufStageRelease(psS);
+	}
+}
+
+int xUBufSetReclaim(ubuf_t * psUB, u32_t Caps) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psUB));
+	if ((psUB->f_alloc == 0) || psUB->f_history || psUB->f_nolock) {
+		errno = EINVAL;
+		return erFAILURE;
+	}
+	int iRV = erFAILURE;
+	errno = ENOSPC;
+	xRtosSemaphoreTake(&muxUBufReg, portMAX_DELAY);
+	for (int i = 0; i < ubufRECLAIM_MAX; ++i) {
+		if ((sUBufReg[i].psUB == NULL) || (sUBufReg[i].psUB == psUB)) {
+			sUBufReg[i] = (ubuf_reg_t) { .psUB = psUB, .Caps = Caps & ~ballocCAP_ZERO,
+				.Seq = psUB->Seq, .tSeen = xTaskGetTickCount() };
+			iRV = erSUCCESS;
+			break;
+		}
+	}
+	xRtosSemaphoreGive(&muxUBufReg);
+	return iRV;
+}
+
+size_t xUBufReclaim(u32_t msIdle) {
+	size_t Total = 0;
+	TickType_t tNow = xTaskGetTickCount();
+	xRtosSemaphoreTake(&muxUBufReg, portMAX_DELAY);
+	for (int i = 0; i < ubufRECLAIM_MAX; ++i) {
+		ubuf_reg_t * psR = &sUBufReg[i];
+		ubuf_t * psUB = psR->psUB;
+		if ((psUB == NULL) || (psUB->pBuf == NULL))
+			continue;
+		u32_t Seq = __atomic_load_n(&psUB->Seq, __ATOMIC_RELAXED);
+		if (Seq != psR->Seq) {							// used since the previous scan
+			psR->Seq = Seq;
+			psR->tSeen = tNow;
+			if (msIdle)
+				continue;
+		}
+		if ((msIdle && ((tNow - psR->tSeen) < pdMS_TO_TICKS(msIdle))) || psUB->f_nolock || psUB->Used)
+			continue;
+		if (bUBufTryLock(psUB) == false)
+			continue;
+		u8_t * pBuf = NULL;
+		if ((psUB->Used == 0) && (psUB->psSpill == NULL)) {	// check again, now locked
+			pBuf = psUB->pBuf;
+			psUB->pBuf = NULL;
+			psUB->IdxRD = psUB->IdxWR = 0;
+			psUB->f_reclaim = 1;
+		}
+		xUBufUnLock(psUB);
+		psR->Seq = psUB->Seq;							// own lock is not activity
+		if (pBuf) {
+			vBFreeType(psUB->psA, ballocTYPE_UBUF, pBuf, psUB->Size);
+			Total += psUB->Size;
+		}
+	}
+	xRtosSemaphoreGive(&muxUBufReg);
+	return Total;
 }
 
+size_t xUBufReclaimHook(size_t Need) { return xUBufReclaim(0); }
+
 void vUBufReset(ubuf_t * psUB) {
 	xUBufLock(psUB);
 	psUB->IdxRD = psUB->IdxWR = psUB->Used = 0; 
+	if (psUB->psSpill) {
+		ubuf_spill_t * psS = psUB->psSpill;
+		if (psS->OffOK == psS->OffWR)
+			psS->OffRD = psS->OffWR = psS->OffOK = 0;
+		else
+			psS->OffRD = psS->OffWR;					// in flight, discarded once written
+		ubuf_zip_t * psZ = psUB->psSpill->psZ;
+		if (psZ)
+			psZ->OffHD = psZ->OffTL = psZ->Used = psZ->RawLen = psZ->RawOff = 0;
+	}
 	xUBufUnLock(psUB);
 }
 
@@ -363,20 +1842,20 @@ int xUBufStringCopy(ubuf_t * psUB, u8_t * pu8Buf, int xLen) {
 /* ONE invariant for both: IdxRD is the FIRST byte of the entry displayed, IdxRD == IdxWR means
  * "not browsing" ie the fresh line below the newest entry. Both stop at their end, neither wraps,
  * and both return strlen EXCLUDING the terminator. */
-static u16_t uUBufBack(ubuf_t * psUB, u16_t Idx) { return Idx ? (Idx - 1) : (psUB->Size - 1); }
-static u16_t uUBufFwd(ubuf_t * psUB, u16_t Idx) { return (Idx + 1) % psUB->Size; }
+static ubidx_t uUBufBack(ubuf_t * psUB, ubidx_t Idx) { return Idx ? (Idx - 1) : (psUB->Size - 1); }
+static ubidx_t uUBufFwd(ubuf_t * psUB, ubidx_t Idx) { return (Idx + 1) % psUB->Size; }
 
 int xUBufStringNxt(ubuf_t * psUB, u8_t * pu8Buf, int Size) {	// cursor UP, OLDER entry
 	IF_myASSERT(debugPARAM, psUB->f_history);
 	if (psUB->Used == 0 || Size < 2)
 		return 0;										// nothing stored yet
-	u16_t Oldest = (psUB->IdxWR + psUB->Size - psUB->Used) % psUB->Size;
+	ubidx_t Oldest = (psUB->IdxWR + psUB->Size - psUB->Used) % psUB->Size;
 	/* On a FULL ring Oldest == IdxWR, which is also the "not browsing" sentinel, so the first UP
 	 * off the fresh line must always be allowed. */
 	if (psUB->IdxRD != psUB->IdxWR && psUB->IdxRD == Oldest)
 		return 0;										// nothing older, caller leaves the line as is
-	u16_t End = uUBufBack(psUB, psUB->IdxRD);			// NUL terminating the previous entry
-	u16_t Start = End;									// walk back to that entry's first character
+	ubidx_t End = uUBufBack(psUB, psUB->IdxRD);		// NUL terminating the previous entry
+	ubidx_t Start = End;									// walk back to that entry's first character
 	while (Start != Oldest && psUB->pBuf[uUBufBack(psUB, Start)] != CHR_NUL)
 		Start = uUBufBack(psUB, Start);
 	int xLen = (End + psUB->Size - Start) % psUB->Size;
@@ -394,7 +1873,7 @@ int xUBufStringPrv(ubuf_t * psUB, u8_t * pu8Buf, int Size) {	// cursor DOWN, NEW
 		return 0;										// nothing stored yet
 	if (psUB->IdxRD == psUB->IdxWR)
 		return 0;										// on the fresh line, nothing newer
-	u16_t Idx = psUB->IdxRD;
+	ubidx_t Idx = psUB->IdxRD;
 	int xMax = psUB->Size;								// bounded: a ring with no NUL looped forever
 	while (xMax-- && psUB->pBuf[Idx] != CHR_NUL)
 		Idx = uUBufFwd(psUB, Idx);
@@ -425,6 +1904,97 @@ void vUBufStringAdd(ubuf_t * psUB, u8_t * pu8Buf, int Size) {
 	}
 }
 
+// ##################################### History persistence #######################################
+
+/**
+ * @brief		write the indices and ring image, copied under the lock and written unlocked
+ */
+static int xUBufHistSaveImage(void * pvHist, int fd) {
+	ubuf_t * psUB = pvHist;
+	size_t Size = psUB->Size;
+	u8_t * pu8Img = pvBAllocType(psUB->psA, ballocTYPE_OTHER, Size, 0);
+	if (pu8Img == NULL) {
+		errno = ENOMEM;
+		return erFAILURE;
+	}
+	xUBufLockRO(psUB);
+	ubuf_hist_t sIdx = { .IdxWR = psUB->IdxWR, .Used = psUB->Used };
+	memcpy(pu8Img, psUB->pBuf, Size);
+	xUBufUnLockRO(psUB);
+	bool bOK = (write(fd, &sIdx, sizeof(sIdx)) == sizeof(sIdx)) && (write(fd, pu8Img, Size) == Size);
+	vBFreeType(psUB->psA, ballocTYPE_OTHER, pu8Img, Size);
+	return bOK ? erSUCCESS : erFAILURE;
+}
+
+/**
+ * @brief		read the indices and ring image, buffer unchanged unless complete and consistent
+ */
+static int xUBufHistLoadImage(void * pvHist, int fd) {
+	ubuf_t * psUB = pvHist;
+	size_t Size = psUB->Size;
+	ubuf_hist_t sIdx;
+	if ((read(fd, &sIdx, sizeof(sIdx)) != sizeof(sIdx)) || (sIdx.IdxWR >= Size) || (sIdx.Used > Size)) {
+		errno = EINVAL;
+		return erFAILURE;
+	}
+	u8_t * pu8Img = pvBAllocType(psUB->psA, ballocTYPE_OTHER, Size, 0);
+	if (pu8Img == NULL) {
+		errno = ENOMEM;
+		return erFAILURE;
+	}
+	int iRV = erFAILURE;
+	if (read(fd, pu8Img, Size) == Size) {
+		xUBufLock(psUB);
+		memcpy(psUB->pBuf, pu8Img, Size);
+		psUB->IdxWR = sIdx.IdxWR;
+		psUB->Used = sIdx.Used;
+		psUB->IdxRD = psUB->IdxWR;						// on the fresh line, not browsing
+		xUBufUnLock(psUB);
+		iRV = erSUCCESS;
+	} else {
+		errno = EINVAL;
+	}
+	vBFreeType(psUB->psA, ballocTYPE_OTHER, pu8Img, Size);
+	return iRV;
+}
+
+/**
+ * @brief		add an appended record to the history, only if complete
+ */
+static int xUBufHistReplay(void * pvHist, int fd, size_t Len) {
+	ubuf_t * psUB = pvHist;
+	if (Len > (psUB->Size - 1))
+		return erFAILURE;
+	u8_t * pu8Rec = pvBAllocType(psUB->psA, ballocTYPE_OTHER, Len + 1, 0);
+	if (pu8Rec == NULL)
+		return erFAILURE;
+	int iRV = erFAILURE;
+	if (read(fd, pu8Rec, Len) == Len) {
+		pu8Rec[Len] = CHR_NUL;
+		vUBufStringAdd(psUB, pu8Rec, Len);
+		iRV = erSUCCESS;
+	}
+	vBFreeType(psUB->psA, ballocTYPE_OTHER, pu8Rec, Len + 1);
+	return iRV;
+}
+
+static const hlog_ops_t sUBufHistOps = {
+	.Magic = ubufHIST_MAGIC, .save = xUBufHistSaveImage, .load = xUBufHistLoadImage, .replay = xUBufHistReplay,
+};
+
+int xUBufHistOpen(ubuf_t * psUB, hlog_t * psL, const char * pccPath) {
+	IF_myASSERT(debugPARAM, halMemorySRAM(psUB) && psUB->f_history && (pccPath != NULL));
+	return xHLogOpen(psL, &sUBufHistOps, psUB, sizeof(ubuf_hist_t) + psUB->Size, 2 * psUB->Size, pccPath);
+}
+
+int xUBufHistAdd(ubuf_t * psUB, hlog_t * psL, u8_t * pu8Buf, int Size) {
+	IF_myASSERT(debugPARAM, psL->pvHist == psUB);
+	if (Size > (psUB->Size - 1))
+		Size = psUB->Size - 1;							// must fit, with terminator, on its own
+	vUBufStringAdd(psUB, pu8Buf, Size);
+	return xHLogAppend(psL, pu8Buf, Size);
+}
+
 // ##################################### ESP-IDF VFS support #######################################
 
 static ubuf_t sUBuf[ubufMAX_OPEN] = { 0 };
@@ -434,7 +2004,12 @@ static int _xUBufOpen(const char * pccPath, int flags, int Size) {
 	int fd = 0;
 	do {
 		if (sUBuf[fd].pBuf == NULL) {
-			sUBuf[fd].pBuf = malloc(Size);
+			sUBuf[fd].pBuf = pvBAllocType(psUBufAlloc, ballocTYPE_UBUF, Size, uBufCaps);
+			if (sUBuf[fd].pBuf == NULL) {
+				errno = ENOMEM;
+				return erFAILURE;
+			}
+			sUBuf[fd].psA = psUBufAlloc;
 			sUBuf[fd]._flags = flags;
 			sUBuf[fd].Size = Size;
 			sUBuf[fd].IdxWR	= sUBuf[fd].IdxRD = sUBuf[fd].Used = 0;
@@ -450,7 +2025,15 @@ static int _xUBufOpen(const char * pccPath, int flags, int Size) {
 static int _xUBufClose(int fd) {
 	if (INRANGE(0, fd, ubufMAX_OPEN-1)) {
 		ubuf_t * psUB = &sUBuf[fd];
-		free(psUB->pBuf);
+		if (psUB->f_stage)
+			vUBufSetStaged(psUB, false);				// staged bytes in first, no stage may keep pointing here
+		if (psUB->psFlush)
+			vUBufFlushStop(psUB);
+		if (psUB->psSpill)
+			vUBufSpillStop(psUB);
+		if (psUB->psDedup)
+			vUBufDedupStop(psUB);
+		vBFreeType(psUB->psA, ballocTYPE_UBUF, psUB->pBuf, psUB->Size);
 		vRtosSemaphoreDelete(&psUB->mux);
 		memset(psUB, 0, sizeof(ubuf_t));
 		return erSUCCESS;
@@ -522,8 +2105,8 @@ int vUBufReport(report_t * psR, ubuf_t * psUB) {
 	if (halMemoryRAM(psUB)) {
 		iRV += xReport(psR, "P=%p  Sz=%d  U=%d  iW=%d  iR=%d  mux=%p  f=x%X",
 			psUB->pBuf, psUB->Size, psUB->Used, psUB->IdxWR, psUB->IdxRD, psUB->mux, psUB->_flags);
-		iRV += xReport(psR, "  fI=%d  fA=%d  fS=%d  fNL=%d  fH=%d" strNL,
-			psUB->f_init, psUB->f_alloc, psUB->f_struct, psUB->f_nolock, psUB->f_history);
+		iRV += xReport(psR, "  fI=%d  fA=%d  fS=%d  fNL=%d  fH=%d  fR=%d" strNL,
+			psUB->f_init, psUB->f_alloc, psUB->f_struct, psUB->f_nolock, psUB->f_history, psUB->f_reclaim);
 		if (psUB->Used) {
 			if (psUB->f_history) {
 				u8_t * pNow = psUB->pBuf;
@@ -546,7 +2129,21 @@ int vUBufReport(report_t * psR, ubuf_t * psUB) {
 						break;
 				}
 			} else {
-				iRV += xReport(psR, "%!'+hhY" strNL, psUB->Used, psUB->pBuf);
+				u8_t caChunk[ubufSNAP_CHUNK];			// consistent copy, writers not blocked
+				u32_t Seq = __atomic_load_n(&psUB->Seq, __ATOMIC_ACQUIRE);
+				for (int Try = 1; (Seq & 1) && (Try < ubufSNAP_RETRY); ++Try) {
+					vBufOvfDelay();
+					Seq = __atomic_load_n(&psUB->Seq, __ATOMIC_ACQUIRE);
+				}
+				size_t Used = psUB->Used, IdxRD = psUB->IdxRD;
+				for (size_t Off = 0; Off < Used; Off += sizeof(caChunk)) {
+					size_t Now = ((Used - Off) < sizeof(caChunk)) ? (Used - Off) : sizeof(caChunk);
+					if (bUBufSnapCopy(psUB, Seq, (IdxRD + Off) % psUB->Size, caChunk, Now) == false) {
+						iRV += xReport(psR, " (modified, %lu of %lu shown)" strNL, Off, Used);
+						break;
+					}
+					iRV += xReport(psR, "%!'+hhY" strNL, Now, caChunk);
+				}
 			}
 		}
 		if (fmTST(aNL))
@@ -558,6 +2155,409 @@ int vUBufReport(report_t * psR, ubuf_t * psUB) {
 // ################################## Diagnostic and testing functions #############################
 
 #define	ubufTEST_SIZE				256
+#ifndef	ubufTEST_SPILL
+	#define	ubufTEST_SPILL			"/spiffs/ubuf.spl"	// any mounted VFS path, override in build config
+#endif
+
+static int xUBufTestCheck(const char * pccName, bool bOK) {
+	PX("%s %s" strNL, pccName, bOK ? "PASSED" : "FAILED");
+	return bOK ? 0 : 1;
+}
+
+static size_t uBufTestSunk;
+
+static int xUBufTestSink(const void * pvBuf, size_t Len) {
+	uBufTestSunk += Len;
+	return Len;
+}
+
+/**
+ * @brief		drain task waits for the latency deadline or the high water mark, not every write
+ * @return		number of checks that failed
+ */
+static int xUBufTestFlush(void) {
+	ubuf_t * psUB = psUBufCreate(NULL, NULL, 64, 0);
+	uBufTestSunk = 0;
+	if ((psUB == NULL) || (xUBufFlushStart(psUB, xUBufTestSink, 32, 20, 0, tskIDLE_PRIORITY + 1) == erFAILURE)) {
+		if (psUB)
+			vUBufDestroy(psUB);
+		return xUBufTestCheck("flush start", false);
+	}
+	xUBufWrite(psUB, "01234567", 8);
+	int iFail = xUBufTestCheck("flush coalesce", (uBufTestSunk == 0) && (xUBufGetUsed(psUB) == 8));
+	vTaskDelay(pdMS_TO_TICKS(60));						// well past the 20mS latency
+	iFail += xUBufTestCheck("flush latency", (uBufTestSunk == 8) && (xUBufGetUsed(psUB) == 0));
+	for (int i = 0; i < 5; ++i)							// 40 bytes, crosses HiWater
+		xUBufWrite(psUB, "01234567", 8);
+	vTaskDelay(pdMS_TO_TICKS(10));						// less than the latency
+	iFail += xUBufTestCheck("flush watermark", uBufTestSunk == 48);
+	vUBufFlushStop(psUB);
+	iFail += xUBufTestCheck("flush stop", psUB->psFlush == NULL);
+	vUBufDestroy(psUB);
+	return iFail;
+}
+
+/**
+ * @brief		each overflow policy applied to a full buffer, outcome counted
+ * @return		number of checks that failed
+ */
+static int xUBufTestPolicy(void) {
+	u8_t caBuf[64];
+	bufovf_t sO;
+	ubuf_t * psUB = psUBufCreate(NULL, NULL, 64, 0);
+	if (psUB == NULL)
+		return xUBufTestCheck("policy create", false);
+	memset(caBuf, CHR_a, sizeof(caBuf));
+	vBufOvfInit(&sO, bufPOLICY_DROPNEW, 0, NULL);
+	vUBufSetPolicy(psUB, &sO);
+	xUBufWrite(psUB, caBuf, 60);
+	errno = 0;
+	int iFail = xUBufTestCheck("policy dropnew", (xUBufWrite(psUB, caBuf, 10) == 0) && (errno == ENOSPC) &&
+				(sO.Count[bufOVF_DROPNEW] == 1) && (sO.Lost == 10));
+	sO.Policy = bufPOLICY_PARTIAL;
+	iFail += xUBufTestCheck("policy partial", (xUBufWrite(psUB, caBuf, 10) == 4) && (xUBufGetUsed(psUB) == 64));
+	sO.Policy = bufPOLICY_BLOCK;
+	sO.msWait = 5;
+	errno = 0;
+	iFail += xUBufTestCheck("policy block", (xUBufWrite(psUB, caBuf, 10) == 0) && (errno == ETIMEDOUT) &&
+				(sO.Count[bufOVF_TIMEOUT] == 1));
+	sO.Policy = bufPOLICY_DROPOLD;
+	xUBufWrite(psUB, "0123456789", 10);
+	ssize_t sRV = xUBufRead(psUB, caBuf, sizeof(caBuf));
+	iFail += xUBufTestCheck("policy dropold", (sRV == 64) && (memcmp(caBuf + 54, "0123456789", 10) == 0) &&
+				(sO.Count[bufOVF_DROPOLD] == 1));
+	vUBufSetPolicy(psUB, NULL);
+	vUBufDestroy(psUB);
+	return iFail;
+}
+
+/**
+ * @brief		writes beyond the ring size spill to file and are read back oldest first
+ * @return		number of checks that failed, 0 if skipped since no file system is mounted
+ */
+static int xUBufTestSpill(void) {
+	u8_t caIn[200], caOut[200];
+	ubuf_t * psUB = psUBufCreate(NULL, NULL, 64, 0);
+	if (psUB == NULL)
+		return xUBufTestCheck("spill create", false);
+	if (xUBufSpillStart(psUB, ubufTEST_SPILL, 16, 0) == erFAILURE) {
+		PX("spill SKIPPED, no file system at " ubufTEST_SPILL strNL);
+		vUBufDestroy(psUB);
+		return 0;
+	}
+	for (int i = 0; i < sizeof(caIn); ++i)
+		caIn[i] = CHR_A + (i % 26);
+	size_t Done = 0;
+	for (int i = 0; Done < sizeof(caIn); ++i) {			// odd sizes, not aligned with Chunk
+		size_t Now = 1 + (i % 19);
+		if (Now > (sizeof(caIn) - Done))
+			Now = sizeof(caIn) - Done;
+		if (xUBufWrite(psUB, caIn + Done, Now) != Now)
+			break;
+		Done += Now;
+	}
+	int iFail = xUBufTestCheck("spill write", (Done == sizeof(caIn)) && (xUBufGetUsed(psUB) == sizeof(caIn)));
+	ssize_t sRV = xUBufRead(psUB, caOut, sizeof(caOut));
+	iFail += xUBufTestCheck("spill read", (sRV == sizeof(caIn)) && (memcmp(caIn, caOut, sizeof(caIn)) == 0));
+	vUBufSpillStop(psUB);
+	vUBufDestroy(psUB);
+	return iFail;
+}
+
+/**
+ * @brief		largest ring supported, above 64K with configBUFFERS_WIDE_INDEX, filled across the wrap
+ * @return		number of checks that failed, 0 if skipped since no memory
+ */
+static int xUBufTestLarge(void) {
+	u8_t caChunk[250];
+	size_t Size = (ubufSIZE_MAXIMUM > 70000) ? 70000 : ubufSIZE_MAXIMUM;
+	ubuf_t * psUB = psUBufCreateCaps(NULL, NULL, Size, 0, NULL, ballocCAP_SPIRAM);
+	if (psUB == NULL)
+		psUB = psUBufCreate(NULL, NULL, Size, 0);
+	if (psUB == NULL) {
+		PX("large SKIPPED, no memory for %lu" strNL, Size);
+		return 0;
+	}
+	u8_t Next = 0, Expect = 0;
+	size_t Total = 0;
+	bool bOK = true;
+	for (int Pass = 0; Pass < 2; ++Pass) {				// fill, drain 3/4, refill across the wrap
+		while (xUBufGetSpace(psUB)) {
+			size_t Now = xUBufGetSpace(psUB);
+			if (Now > sizeof(caChunk))
+				Now = sizeof(caChunk);
+			for (int i = 0; i < Now; ++i)
+				caChunk[i] = Next++;
+			xUBufWrite(psUB, caChunk, Now);
+			Total += Now;
+		}
+		bOK = bOK && (xUBufGetUsed(psUB) == Size);
+		size_t Drain = Pass ? Size : (Size / 4 * 3);
+		while (Drain) {
+			ssize_t sRV = xUBufRead(psUB, caChunk, (Drain < sizeof(caChunk)) ? Drain : sizeof(caChunk));
+			if (sRV <= 0)
+				break;
+			for (int i = 0; i < sRV; ++i)
+				bOK = bOK && (caChunk[i] == Expect++);
+			Drain -= sRV;
+		}
+	}
+	int iFail = xUBufTestCheck("large", bOK && (Total == (Size + Size / 4 * 3)) && (xUBufGetUsed(psUB) == 0));
+	vUBufDestroy(psUB);
+	return iFail;
+}
+
+/**
+ * @brief		pattern found across the wrap boundary, from a start offset, or not at all
+ * @return		number of checks that failed
+ */
+static int xUBufTestFind(void) {
+	u8_t caBuf[64];
+	ubuf_t * psUB = psUBufCreate(NULL, NULL, 64, 0);
+	if (psUB == NULL)
+		return xUBufTestCheck("find create", false);
+	memset(caBuf, CHR_a, sizeof(caBuf));
+	xUBufWrite(psUB, caBuf, 58);
+	xUBufRead(psUB, caBuf, 58);							// IdxRD = IdxWR = 58
+	xUBufWrite(psUB, "GET /\r\n\r\nGET /b\r\n\r\n", 19);	// first CR/LF/CR/LF straddles the wrap
+	int iFail = xUBufTestCheck("find wrap", xUBufFind(psUB, "\r\n\r\n", 4, 0) == 5);
+	iFail += xUBufTestCheck("find start", xUBufFind(psUB, "\r\n\r\n", 4, 6) == 15);
+	iFail += xUBufTestCheck("find absent", xUBufFind(psUB, "POST", 4, 0) == erFAILURE);
+	iFail += xUBufTestCheck("find intact", xUBufGetUsed(psUB) == 19);
+	vUBufDestroy(psUB);
+	return iFail;
+}
+
+/**
+ * @brief		older data compressed into the arena, read back in order without loss
+ * @return		number of checks that failed
+ */
+static int xUBufTestZip(void) {
+	char caLine[48];
+	u8_t caOut[64];
+	ubuf_t * psUB = psUBufCreate(NULL, NULL, 64, 0);
+	if ((psUB == NULL) || (xUBufZipStart(psUB, 32, 1024) == erFAILURE)) {
+		if (psUB)
+			vUBufDestroy(psUB);
+		return xUBufTestCheck("zip start", false);
+	}
+	size_t Total = 0;
+	for (int i = 0; i < 16; ++i) {						// 512 bytes of similar text into a 64 byte ring
+		snprintf(caLine, sizeof(caLine), "I (%06d) wifi: rssi=-%02d ch=6 %08d\n", i * 7, 40 + i, i);
+		Total += xUBufWrite(psUB, caLine, 32);
+	}
+	int iFail = xUBufTestCheck("zip write", (Total == 512) && (xUBufGetUsed(psUB) == 512));
+	bool bOK = true;
+	for (int i = 0; i < 16; ++i) {
+		snprintf(caLine, sizeof(caLine), "I (%06d) wifi: rssi=-%02d ch=6 %08d\n", i * 7, 40 + i, i);
+		bOK = bOK && (xUBufRead(psUB, caOut, 32) == 32) && (memcmp(caOut, caLine, 32) == 0);
+	}
+	iFail += xUBufTestCheck("zip read", bOK && (psUB->psSpill->psZ->Lost == 0) && (xUBufGetUsed(psUB) == 0));
+	vUBufSpillStop(psUB);
+	vUBufDestroy(psUB);
+	return iFail;
+}
+
+/**
+ * @brief		consistent lock free copy, retried then refused while a writer is mid update
+ * @return		number of checks that failed
+ */
+static int xUBufTestSnapshot(void) {
+	u8_t caBuf[16];
+	ubuf_t * psUB = psUBufCreate(NULL, NULL, 64, 0);
+	if (psUB == NULL)
+		return xUBufTestCheck("snapshot create", false);
+	xUBufWrite(psUB, "0123456789", 10);
+	int iFail = xUBufTestCheck("snapshot", (xUBufSnapshot(psUB, caBuf, 4) == 4) && (memcmp(caBuf, "6789", 4) == 0));
+	u32_t Seq = psUB->Seq;
+	iFail += xUBufTestCheck("snapshot stale", bUBufSnapCopy(psUB, Seq - 2, psUB->IdxRD, caBuf, 4) == false);
+	psUB->Seq = Seq + 1;								// as if locked by a writer
+	errno = 0;
+	iFail += xUBufTestCheck("snapshot retry", (xUBufSnapshot(psUB, caBuf, 4) == erFAILURE) && (errno == EAGAIN));
+	psUB->Seq = Seq + 2;
+	iFail += xUBufTestCheck("snapshot after", (xUBufSnapshot(psUB, caBuf, 16) == 10) && (xUBufGetUsed(psUB) == 10));
+	vUBufDestroy(psUB);
+	return iFail;
+}
+
+/**
+ * @brief		repeated lines counted, run reported when a different line arrives
+ * @return		number of checks that failed
+ */
+static int xUBufTestDedup(void) {
+	char caBuf[64];
+	ubuf_t * psUB = psUBufCreate(NULL, NULL, 64, 0);
+	if ((psUB == NULL) || (xUBufDedupStart(psUB, 0) == erFAILURE)) {
+		if (psUB)
+			vUBufDestroy(psUB);
+		return xUBufTestCheck("dedup start", false);
+	}
+	int iFail = xUBufTestCheck("dedup again", xUBufDedupStart(psUB, 0) == erFAILURE);
+	for (int i = 0; i < 3; ++i)
+		xUBufWrite(psUB, "x\n", 2);
+	xUBufWrite(psUB, "y\n", 2);
+	ssize_t sRV = xUBufRead(psUB, caBuf, sizeof(caBuf) - 1);
+	caBuf[(sRV > 0) ? sRV : 0] = CHR_NUL;
+	iFail += xUBufTestCheck("dedup", (psUB->psDedup->Total == 2) && (strcmp(caBuf, "x\nlast message repeated 2 times" strNL "y\n") == 0));
+	xUBufWrite(psUB, "z\nz\n", 4);
+	vUBufDedupFlush(psUB);								// pending run reported without a new line
+	sRV = xUBufRead(psUB, caBuf, sizeof(caBuf) - 1);
+	caBuf[(sRV > 0) ? sRV : 0] = CHR_NUL;
+	iFail += xUBufTestCheck("dedup flush", strcmp(caBuf, "z\nlast message repeated 1 times" strNL) == 0);
+	vUBufDedupStop(psUB);
+	xUBufWrite(psUB, "z\nz\n", 4);
+	iFail += xUBufTestCheck("dedup stop", (psUB->psDedup == NULL) && (xUBufGetUsed(psUB) == 4));
+	vUBufDestroy(psUB);
+	return iFail;
+}
+
+/**
+ * @brief		task writes combined till LF or flush, written out when staging is switched off
+ * @return		number of checks that failed
+ */
+static int xUBufTestStage(void) {
+	char caBuf[16];
+	ubuf_t * psUB = psUBufCreate(NULL, NULL, 64, 0);
+	if (psUB == NULL)
+		return xUBufTestCheck("stage create", false);
+	vUBufSetStaged(psUB, true);
+	xUBufWrite(psUB, "ab", 2);
+	xUBufWrite(psUB, "c", 1);
+	int iFail = xUBufTestCheck("stage held", xUBufGetUsed(psUB) == 0);
+	xUBufWrite(psUB, "\nde", 3);
+	ssize_t sRV = xUBufRead(psUB, caBuf, sizeof(caBuf));
+	iFail += xUBufTestCheck("stage LF", (sRV == 4) && (memcmp(caBuf, "abc\n", 4) == 0));
+	vUBufStageFlush();
+	sRV = xUBufRead(psUB, caBuf, sizeof(caBuf));
+	iFail += xUBufTestCheck("stage flush", (sRV == 2) && (memcmp(caBuf, "de", 2) == 0));
+	xUBufWrite(psUB, "fg", 2);
+	vUBufSetStaged(psUB, false);
+	iFail += xUBufTestCheck("stage off", xUBufGetUsed(psUB) == 2);
+	xUBufWrite(psUB, "h", 1);
+	iFail += xUBufTestCheck("stage bypass", xUBufGetUsed(psUB) == 3);
+	vUBufDestroy(psUB);
+	return iFail;
+}
+
+static u8_t caUBufTestOut[48];
+static size_t uBufTestOut, uBufTestCap;
+
+static int xUBufTestCapture(const void * pvBuf, size_t Len) {
+	if (Len > uBufTestCap)
+		Len = uBufTestCap;								// partial acceptance, rest stays pending
+	if (Len > (sizeof(caUBufTestOut) - uBufTestOut))
+		Len = sizeof(caUBufTestOut) - uBufTestOut;
+	memcpy(caUBufTestOut + uBufTestOut, pvBuf, Len);
+	uBufTestOut += Len;
+	return Len;
+}
+
+/**
+ * @brief		data transformed by each stage in turn, output the sink did not take kept pending
+ * @return		number of checks that failed
+ */
+static int xUBufTestChain(void) {
+	u8_t caBuf[48];
+	ubuf_chain_t sC;
+	ubuf_t * psUB = psUBufCreate(NULL, NULL, 64, 0);
+	if (psUB == NULL)
+		return xUBufTestCheck("chain create", false);
+	vUBufChainInit(&sC, xUBufTestCapture);
+	xUBufChainAdd(&sC, xUBufXformANSI, NULL);
+	xUBufChainAdd(&sC, xUBufXformCRLF, NULL);
+	memset(caBuf, CHR_a, sizeof(caBuf));
+	xUBufWrite(psUB, caBuf, 48);
+	xUBufRead(psUB, caBuf, 48);							// next write wraps
+	const char caIn[] = "\x1b[1;31mred\x1b[0m\nA\r\nB\n";
+	xUBufWrite(psUB, caIn, sizeof(caIn) - 1);
+	uBufTestOut = 0;
+	uBufTestCap = sizeof(caUBufTestOut);
+	int iRV = xUBufEmptyChain(psUB, &sC, 0);
+	int iFail = xUBufTestCheck("chain", (iRV == sizeof(caIn) - 1) && (uBufTestOut == 11) &&
+				(memcmp(caUBufTestOut, "red\r\nA\r\nB\r\n", 11) == 0));
+	vUBufChainInit(&sC, xUBufTestCapture);
+	xUBufChainAdd(&sC, xUBufXformHex, NULL);
+	xUBufWrite(psUB, "\x01\x02\xab", 3);
+	uBufTestOut = 0;
+	uBufTestCap = 4;
+	iRV = xUBufEmptyChain(psUB, &sC, 0);
+	iFail += xUBufTestCheck("chain partial", (iRV == 3) && (uBufTestOut == 4) && (xUBufChainPending(&sC) == 2));
+	uBufTestCap = sizeof(caUBufTestOut);
+	iRV = xUBufEmptyChain(psUB, &sC, 0);
+	iFail += xUBufTestCheck("chain pending", (iRV == 0) && (uBufTestOut == 6) &&
+				(memcmp(caUBufTestOut, "0102AB", 6) == 0) && (xUBufChainPending(&sC) == 0));
+	vUBufDestroy(psUB);
+	return iFail;
+}
+
+/**
+ * @brief		ring to ring move across both wraps, limited by the destination space
+ * @return		number of checks that failed
+ */
+static int xUBufTestSplice(void) {
+	u8_t caBuf[64];
+	ubuf_t * psA = psUBufCreate(NULL, NULL, 64, 0);
+	ubuf_t * psB = psUBufCreate(NULL, NULL, 64, 0);
+	if ((psA == NULL) || (psB == NULL)) {
+		if (psA)
+			vUBufDestroy(psA);
+		if (psB)
+			vUBufDestroy(psB);
+		return xUBufTestCheck("splice create", false);
+	}
+	memset(caBuf, CHR_a, sizeof(caBuf));
+	xUBufWrite(psA, caBuf, 60);
+	xUBufRead(psA, caBuf, 50);
+	xUBufWrite(psA, "abcdefghij", 10);					// source wraps
+	xUBufWrite(psB, caBuf, 56);
+	xUBufRead(psB, caBuf, 56);							// destination wraps
+	int iFail = xUBufTestCheck("splice self", xUBufSplice(psA, psA, 0) == erFAILURE);
+	ssize_t sRV = xUBufSplice(psB, psA, 0);
+	iFail += xUBufTestCheck("splice", (sRV == 20) && (xUBufGetUsed(psA) == 0) &&
+				(xUBufRead(psB, caBuf, 20) == 20) && (memcmp(caBuf + 10, "abcdefghij", 10) == 0));
+	xUBufWrite(psA, caBuf, 30);
+	xUBufWrite(psB, caBuf, 50);
+	sRV = xUBufSplice(psB, psA, 0);
+	iFail += xUBufTestCheck("splice partial", (sRV == 14) && (xUBufGetUsed(psA) == 16) && (xUBufGetSpace(psB) == 0));
+	vUBufDestroy(psA);
+	vUBufDestroy(psB);
+	return iFail;
+}
+
+static int xUBufTestReclaim(void) {
+	u8_t caBuf[16];
+	size_t Len;
+	ubuf_t * psA = psUBufCreateCaps(NULL, NULL, ubufTEST_SIZE, 0, NULL, ballocCAP_DEFAULT);
+	ubuf_t * psB = psUBufCreateCaps(NULL, NULL, ubufTEST_SIZE, 0, NULL, ballocCAP_DEFAULT);
+	if ((psA == NULL) || (psB == NULL)) {
+		if (psA)
+			vUBufDestroy(psA);
+		if (psB)
+			vUBufDestroy(psB);
+		return xUBufTestCheck("reclaim create", false);
+	}
+	vBAllocSetBudget(xBAllocUsed(-1) + ubufTEST_SIZE / 2);
+	errno = 0;
+	ubuf_t * psC = psUBufCreateCaps(NULL, NULL, ubufTEST_SIZE, 0, NULL, ballocCAP_DEFAULT);
+	int iFail = xUBufTestCheck("reclaim budget", (psC == NULL) && (errno == ENOMEM));
+	if (psC)
+		vUBufDestroy(psC);
+	iFail += xUBufTestCheck("reclaim register", (xUBufSetReclaim(psA, ballocCAP_DEFAULT) == erSUCCESS) &&
+				(xUBufSetReclaim(psB, ballocCAP_DEFAULT) == erSUCCESS));
+	xUBufWrite(psA, "hello", 5);
+	xUBufReclaim(10);									// psA used, psB just seen
+	vTaskDelay(pdMS_TO_TICKS(30));
+	xUBufReclaim(10);
+	iFail += xUBufTestCheck("reclaim idle", (psA->pBuf != NULL) && (psB->pBuf == NULL) && psB->f_reclaim);
+	errno = 0;
+	iFail += xUBufTestCheck("reclaim peek", (pcUBufPeek(psB, &Len) == NULL) && (Len == 0) && (errno == ENODATA));
+	iFail += xUBufTestCheck("reclaim realloc", (xUBufWrite(psB, "world", 5) == 5) && (psB->f_reclaim == 0) &&
+				(xUBufRead(psB, caBuf, 5) == 5) && (memcmp(caBuf, "world", 5) == 0));
+	vBAllocSetBudget(0);
+	vUBufDestroy(psA);
+	vUBufDestroy(psB);
+	return iFail;
+}
 
 void vUBufTest(void) {
 	vUBufInit();
@@ -629,4 +2629,20 @@ void vUBufTest(void) {
 
 	Result = close(fd);
 	PX("Result (%d) close() buffer =  %s" strNL, Result, (Result == erSUCCESS) ? "Passed" : "Failed");
+
+	// optional mechanisms, not using the VFS
+	Result = 0;
+	Result += xUBufTestFlush();
+	Result += xUBufTestPolicy();
+	Result += xUBufTestSpill();
+	Result += xUBufTestLarge();
+	Result += xUBufTestFind();
+	Result += xUBufTestZip();
+	Result += xUBufTestSnapshot();
+	Result += xUBufTestDedup();
+	Result += xUBufTestStage();
+	Result += xUBufTestChain();
+	Result += xUBufTestSplice();
+	Result += xUBufTestReclaim();
+	PX("Optional mechanisms: %d checks failed" strNL, Result);
 }
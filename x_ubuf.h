@@ -4,6 +4,11 @@
 
 #include "definitions.h"
 #include "FreeRTOS_Support.h"
+#include "x_balloc.h"
+#include "x_blz.h"
+#include "x_bufdig.h"
+#include "x_bufovf.h"
+#include "x_hlog.h"
 
 #include <fcntl.h>
 
@@ -13,6 +18,43 @@ extern "C" {
 
 // ##################################### MACRO definitions #########################################
 
+#define	ubufFLUSH_STACK				3072
+#define	ubufFLUSH_RETRY_MS			10			// back off when the sink accepts nothing
+#define	ubufSPILL_XFER				256			// stack buffer used to drain spilled data
+#define	ubufSNAP_RETRY				8			// snapshot attempts before giving up
+#define	ubufSNAP_CHUNK				64			// stack copy per report line, see vUBufReport()
+#define	ubufDEDUP_LINE				128			// longest line checked for repeats
+#define	ubufFILT_MAX				4			// stages in a drain filter chain
+
+// ###################################### BUILD : CONFIG definitions ###############################
+
+#ifndef configBUFFERS_WIDE_INDEX
+	#define	configBUFFERS_WIDE_INDEX	0			// 1 = 32bit indexes, multi-MB (PSRAM) rings
+#endif
+
+#ifndef ubufSTAGE_SIZE
+	#define	ubufSTAGE_SIZE			128			// per task write combining buffer, see vUBufSetStaged()
+#endif
+
+#ifndef ubufSTAGE_TLS
+	#define	ubufSTAGE_TLS			(configNUM_THREAD_LOCAL_STORAGE_POINTERS - 1)
+#endif
+
+#ifndef ubufFILT_SCRATCH
+	#define	ubufFILT_SCRATCH		128			// output buffer per filter stage
+#endif
+
+#ifndef ubufRECLAIM_MAX
+	#define	ubufRECLAIM_MAX			8			// rings that can release idle storage, see xUBufSetReclaim()
+#endif
+
+#if (configBUFFERS_WIDE_INDEX > 0)
+	typedef u32_t ubidx_t;
+	#define	ubufSIZE_MAXIMUM		(32 * 1024 * 1024)
+#else
+	typedef u16_t ubidx_t;						// compact layout, internal RAM rings
+	#define	ubufSIZE_MAXIMUM		16384
+#endif
 
 // ####################################### enumerations ############################################
 
@@ -20,13 +62,24 @@ enum { ioctlUBUF_UNDEFINED, ioctlUBUF_I_PTR_CNTL, ioctlUBUF_NUMBER };
 
 // ####################################### structures  #############################################
 
+struct ubuf_flush_t;
+struct ubuf_spill_t;
+struct ubuf_dedup_t;
+
 typedef	struct ubuf_t {
 	u8_t * pBuf;
 	SemaphoreHandle_t mux;
-	volatile u16_t IdxWR;			// index to next space to WRITE to
-	volatile u16_t IdxRD;			// index to next char to be READ from
-	volatile u16_t Used;
-	u16_t Size;
+	struct ubuf_flush_t * psFlush;	// optional background drain task
+	bufovf_t * psOvf;				// optional overflow policy, NULL = use _flags
+	struct ubuf_spill_t * psSpill;	// optional overflow to storage
+	struct ubuf_dedup_t * psDedup;	// optional repeated line suppression
+	bufdig_t * psDig;				// optional running digest, write or drain side
+	const balloc_t * psA;			// allocator used for pBuf, if f_alloc set
+	volatile u32_t Seq;				// odd while being modified, see xUBufSnapshot()
+	volatile ubidx_t IdxWR;			// index to next space to WRITE to
+	volatile ubidx_t IdxRD;			// index to next char to be READ from
+	volatile ubidx_t Used;
+	ubidx_t Size;
 	u16_t _flags;					// stdlib related flags
 	u8_t count;						// history command counter
 	union {
@@ -36,12 +89,103 @@ typedef	struct ubuf_t {
 			u8_t f_struct:1;		// struct malloc'd
 			u8_t f_nolock:1;
 			u8_t f_history:1;
-			u8_t f_spare:3;
+			u8_t f_stage:1;			// task writes combined, see vUBufSetStaged()
+			u8_t f_reclaim:1;		// pBuf released while idle, reallocated on next write
+			u8_t f_spare:1;
 		};
 		u8_t f_flags;				// module flags
 	};
 } ubuf_t;
-DUMB_STATIC_ASSERT(sizeof(ubuf_t) == (12 + sizeof(char *) + sizeof(SemaphoreHandle_t)));
+DUMB_STATIC_ASSERT(sizeof(ubuf_t) == (8 + (4 * sizeof(ubidx_t)) + (7 * sizeof(char *)) + sizeof(SemaphoreHandle_t)));
+
+typedef struct ubuf_flush_t {
+	ubuf_t * psUB;
+	int (*hdlr)(const void *, size_t);
+	TaskHandle_t xTask;
+	volatile TickType_t tFirst;		// tick at which the oldest undrained byte was written
+	ubidx_t HiWater;				// drain immediately once Used reaches this level
+	ubidx_t MaxPass;				// max bytes drained per pass, 0 = no limit
+	u16_t msLatency;				// else drain once oldest byte is this old
+	volatile u8_t f_run;
+} ubuf_flush_t;
+
+typedef struct ubuf_zip_t {
+	u8_t * pArena;					// ring of compressed blocks: u16_t Zip, u16_t Raw, data
+	u8_t * pRaw;					// oldest block, decompressed
+	u16_t * pHash;					// compressor work area
+	u32_t Size;						// arena size
+	u32_t OffHD;					// arena offset of oldest block
+	u32_t OffTL;					// arena offset of next block to be added
+	u32_t Used;						// arena bytes used, including skipped tail space
+	u32_t Lost;						// raw bytes evicted unread to make space
+	ubidx_t Block;					// maximum raw bytes per block
+	ubidx_t RawLen;					// bytes in pRaw, 0 = oldest block not yet decompressed
+	ubidx_t RawOff;					// bytes of pRaw already consumed
+} ubuf_zip_t;
+
+typedef struct ubuf_spill_t {
+	int fd;							// open spill file, -1 if compressed in RAM
+	ubuf_zip_t * psZ;				// compressed RAM arena, NULL if spilling to file
+	SemaphoreHandle_t mux;			// file access, held while writing WITHOUT the buffer lock
+	u8_t * pXfer;					// Chunk bytes taken from RAM, being written to the file
+	u32_t OffRD;					// file offset of next byte to be READ
+	u32_t OffWR;					// file offset of next byte to be WRITTEN, includes in flight
+	u32_t OffOK;					// end of data in the file, < OffWR while a write is in flight
+	u32_t Max;						// maximum file size, 0 = unlimited
+	u32_t Total;					// total bytes ever spilled
+	u32_t Lost;						// bytes taken from RAM but not written due to I/O errors
+	ubidx_t Chunk;					// minimum bytes moved to storage per spill
+	char caPath[];
+} ubuf_spill_t;
+
+typedef struct ubuf_dedup_t {
+	SemaphoreHandle_t mux;			// serialises line assembly, taken before the buffer lock
+	TickType_t tFirst;				// tick of the first repeat in the current run
+	u32_t Hash;						// FNV-1a of the line being assembled
+	u32_t LastHash;					// of the last line committed
+	u32_t Count;					// repeats suppressed in the current run
+	u32_t Total;					// repeats ever suppressed
+	u16_t LastLen;					// length of last line committed, 0 = none (too long)
+	u16_t Len;						// bytes in caLine
+	u16_t msLimit;					// report a run at least this often, 0 = only once it ends
+	u8_t f_long:1;					// line too long, passed through unchecked
+	u8_t f_spare:7;
+	char caLine[ubufDEDUP_LINE];
+} ubuf_dedup_t;
+
+typedef struct ubuf_stage_t {
+	struct ubuf_stage_t * psNext;	// list of all stages, see vUBufSetStaged()
+	ubuf_t * psUB;					// buffer the staged bytes belong to
+	u16_t Len;						// bytes staged
+	volatile u8_t Busy;				// claimed by the owner task or by a drainer
+	volatile u8_t f_dead;			// owner task deleted, freed on the next list walk
+	u8_t Buf[ubufSTAGE_SIZE];
+} ubuf_stage_t;
+
+struct ubuf_filt_t;
+
+/**
+ * @brief		filter stage transform, convert input into at most Max bytes of output
+ * @param[in]	psF - stage, State and pvCtx are for use by the transform
+ * @param[out]	pUsed - number of input bytes consumed, may be less than Len if output is full
+ * @return		number of output bytes produced
+ */
+typedef size_t (* ubuf_xform_t)(struct ubuf_filt_t * psF, const u8_t * pIn, size_t Len, size_t * pUsed, u8_t * pOut, size_t Max);
+
+typedef struct ubuf_filt_t {
+	ubuf_xform_t xform;
+	void * pvCtx;					// optional, supplied with the stage
+	u32_t State;					// private to the transform, 0 at start
+	u16_t RD;						// next output byte not yet taken by the next stage
+	u16_t WR;						// end of output
+	u8_t caOut[ubufFILT_SCRATCH];
+} ubuf_filt_t;
+
+typedef struct ubuf_chain_t {
+	int (*hdlr)(const void *, size_t);	// final sink
+	u8_t Stages;
+	ubuf_filt_t sFilt[ubufFILT_MAX];
+} ubuf_chain_t;
 
 // ################################### EXTERNAL FUNCTIONS ##########################################
 
@@ -53,7 +197,7 @@ DUMB_STATIC_ASSERT(sizeof(ubuf_t) == (12 + sizeof(char *) + sizeof(SemaphoreHand
 size_t xUBufSetDefaultSize(size_t);
 
 /**
- * @brief		get number of bytes used in buffer
+ * @brief		get number of bytes used in buffer, including any spilled to storage
  * @param[in]	psUB - pointer to buffer control structure
  * @return		positive integer 0 or greater
  */
@@ -75,6 +219,126 @@ int	xUBufGetSpace(ubuf_t * psUB);
  */
 int xUBufEmptyBlock(ubuf_t * psUB, int (*hdlr)(const void *, size_t));
 
+/**
+ * @brief		empty buffer using the block handler supplied, stop after Max bytes
+ * @param[in]	psUB - pointer to buffer control structure
+ * @param[in]	hdlr - block write handler API
+ * @param[in]	Max - maximum number of bytes to hand to the handler, 0 = no limit
+ * @return		0+ value (number of bytes written) else < 0 (error code)
+ */
+int xUBufEmptyLimit(ubuf_t * psUB, int (*hdlr)(const void *, size_t), size_t Max);
+
+/**
+ * @brief		initialise a drain filter chain, initially without stages
+ * @param[in]	psC - pointer to chain, use with ONE buffer only
+ * @param[in]	hdlr - final sink
+ */
+void vUBufChainInit(ubuf_chain_t * psC, int (*hdlr)(const void *, size_t));
+
+/**
+ * @brief		append a stage, data flows through the stages in the order added
+ * @param[in]	xform - transform, eg xUBufXform???()
+ * @param[in]	pvCtx - optional context for the transform
+ * @return		erSUCCESS or erFAILURE with errno set if the chain is full
+ */
+int xUBufChainAdd(ubuf_chain_t * psC, ubuf_xform_t xform, void * pvCtx);
+
+/**
+ * @brief		number of bytes taken from the buffer but not yet accepted by the sink
+ */
+size_t xUBufChainPending(ubuf_chain_t * psC);
+
+/**
+ * @brief		empty buffer through the filter chain to its sink, each byte copied once per stage
+ * @param[in]	psUB - pointer to buffer control structure
+ * @param[in]	psC - pointer to chain
+ * @param[in]	Max - maximum number of bytes taken from the buffer, 0 = no limit
+ * @return		number of bytes taken from the buffer else < 0 (handler error code)
+ * @note		Both ring segments are fed to the first stage in place. Output the sink did not (yet)
+ * 				accept stays in the chain and is sent first on the next call.
+ */
+int xUBufEmptyChain(ubuf_t * psUB, ubuf_chain_t * psC, size_t Max);
+
+// Ready made transforms, for use with xUBufChainAdd()
+size_t xUBufXformCRLF(ubuf_filt_t * psF, const u8_t * pIn, size_t Len, size_t * pUsed, u8_t * pOut, size_t Max);	// LF -> CR/LF, unless preceded by CR
+size_t xUBufXformANSI(ubuf_filt_t * psF, const u8_t * pIn, size_t Len, size_t * pUsed, u8_t * pOut, size_t Max);	// strip ESC sequences
+size_t xUBufXformIAC(ubuf_filt_t * psF, const u8_t * pIn, size_t Len, size_t * pUsed, u8_t * pOut, size_t Max);	// telnet, 0xFF -> 0xFF 0xFF
+size_t xUBufXformHex(ubuf_filt_t * psF, const u8_t * pIn, size_t Len, size_t * pUsed, u8_t * pOut, size_t Max);	// each byte as 2 hex digits
+
+/**
+ * @brief		start a background task draining the buffer to the handler supplied
+ * @param[in]	psUB - pointer to buffer control structure
+ * @param[in]	hdlr - block write handler API
+ * @param[in]	HiWater - drain as soon as this many bytes are buffered
+ * @param[in]	msLatency - else drain once the oldest buffered byte is this old
+ * @param[in]	MaxPass - maximum bytes drained per pass, 0 = no limit. Data left behind by a capped
+ * 				pass keeps its age, passes follow each other until the buffer is empty
+ * @param[in]	Prio - priority of the drain task
+ * @return		erSUCCESS or erFAILURE with errno set
+ * @note		small writes are coalesced (Nagle-like) with a bounded delay
+ */
+int xUBufFlushStart(ubuf_t * psUB, int (*hdlr)(const void *, size_t), size_t HiWater, u16_t msLatency, size_t MaxPass, UBaseType_t Prio);
+
+/**
+ * @brief		stop the background drain task, if any, and release its resources
+ * @param[in]	psUB - pointer to buffer control structure
+ * @note		anything still buffered is left in place, NOT drained
+ */
+void vUBufFlushStop(ubuf_t * psUB);
+
+/**
+ * @brief		attach (or detach) an overflow policy to the buffer
+ * @param[in]	psUB - pointer to buffer control structure
+ * @param[in]	psO - pointer to initialised policy structure, NULL to revert to _flags behaviour
+ * @note		the callback in the policy structure must NOT write to the same buffer
+ * @note		with spilling active (xUBufSpillStart()/xUBufZipStart()) the policy only applies once the
+ * 				spill file is full or fails, never while compressing
+ */
+void vUBufSetPolicy(ubuf_t * psUB, bufovf_t * psO);
+
+/**
+ * @brief		attach (or detach) a running digest, updated during the existing copies
+ * @param[in]	psUB - pointer to buffer control structure
+ * @param[in]	psD - pointer to initialised digest, NULL to detach
+ * @note		bufDIG_WRITE covers bytes stored by xUBufWrite(), bufDIG_DRAIN bytes returned by
+ * 				xUBufRead() or accepted by the xUBufEmpty???() handler. Bytes discarded by O_TRUNC,
+ * 				an overflow policy or zip eviction are not included on the drain side.
+ */
+void vUBufSetDigest(ubuf_t * psUB, bufdig_t * psD);
+
+/**
+ * @brief		enable spilling of oldest data to a file if a write does not fit
+ * @param[in]	psUB - pointer to buffer control structure
+ * @param[in]	pcPath - full VFS path of spill file, created or truncated
+ * @param[in]	Chunk - minimum number of bytes moved per spill, 0 = 1/4 of buffer size
+ * @param[in]	Max - maximum spill file size, 0 = unlimited
+ * @return		erSUCCESS or erFAILURE with errno set
+ * @note		Spilled data is older than data in RAM hence always read/drained first.
+ * @note		Spilling takes precedence over an overflow policy (vUBufSetPolicy()), the policy or
+ * 				flags only apply once the file reaches Max or a write to it fails.
+ * @note		The file is written without the buffer lock held, other writers are not delayed by
+ * 				storage latency. Readers get EAGAIN for spilled data while a file write is in flight.
+ */
+int xUBufSpillStart(ubuf_t * psUB, const char * pcPath, size_t Chunk, size_t Max);
+
+/**
+ * @brief		enable compressed retention, oldest data compressed into a RAM arena if a write does not fit
+ * @param[in]	psUB - pointer to buffer control structure
+ * @param[in]	Block - raw bytes compressed per block, 0 = 1/4 of buffer size, max blzMAX_BLOCK
+ * @param[in]	Arena - size of compressed arena, at least 2 blocks
+ * @return		erSUCCESS or erFAILURE with errno set
+ * @note		Uses the spill mechanism (stop with vUBufSpillStop) with the same read order. Once the
+ * 				arena is full the oldest compressed blocks are discarded, counted in ubuf_zip_t.Lost.
+ * 				Hence an overflow policy (vUBufSetPolicy()) never applies while compressing.
+ */
+int xUBufZipStart(ubuf_t * psUB, size_t Block, size_t Arena);
+
+/**
+ * @brief		disable spilling, discard unread spilled data and remove the file
+ * @param[in]	psUB - pointer to buffer control structure
+ */
+void vUBufSpillStop(ubuf_t * psUB);
+
 /**
  * @brief		read a character from the buffer
  * @param[in]	psUB - pointer to buffer control structure
@@ -110,9 +374,102 @@ int	xUBufRead(ubuf_t *psUB, const void * pBuf, size_t Size);
  * @brief		write multiple characters to the buffer
  * @param[in]	psUB - pointer to buffer control structure
  * @return		number of characters written or 0 (if O_NONBLOCK) with EAGAIN set
+ * @note		with an overflow policy attached, dropped writes are reported as fully written
  */
 ssize_t xUBufWrite(ubuf_t * psUB, const void * pBuf, size_t Size);
 
+/**
+ * @brief		find a pattern in the readable data without consuming or copying it
+ * @param[in]	psUB - pointer to buffer control structure
+ * @param[in]	pvPat - pattern to find, may straddle the wrap boundary
+ * @param[in]	Len - pattern length
+ * @param[in]	Start - offset (from the read position) at which to start searching
+ * @return		offset of the pattern from the read position, erFAILURE if not (yet) buffered
+ * @note		Only data in RAM is searched. Offsets still count any spilled data in front of it, so
+ * 				reading Offset + Len bytes always returns the complete frame.
+ */
+ssize_t xUBufFind(ubuf_t * psUB, const void * pvPat, size_t Len, size_t Start);
+
+/**
+ * @brief		copy a consistent view of the newest readable data, never takes the lock
+ * @param[in]	psUB - pointer to buffer control structure
+ * @param[out]	pvBuf - buffer to copy into
+ * @param[in]	Size - size of buffer, if less than the data buffered only the newest Size bytes
+ * @return		number of bytes copied or erFAILURE with errno = EAGAIN if writers kept racing
+ * @note		Seqlock reader: retried if the buffer was modified during the copy. Only data in
+ * 				RAM is copied, in history mode this includes all entries. Nothing is consumed.
+ */
+ssize_t xUBufSnapshot(ubuf_t * psUB, void * pvBuf, size_t Size);
+
+/**
+ * @brief		enable suppression of repeated lines, written as "last message repeated N times"
+ * @param[in]	psUB - pointer to buffer control structure
+ * @param[in]	msLimit - during a long run report the count at least this often, 0 = at end only
+ * @return		erSUCCESS or erFAILURE with errno set
+ * @note		Writes are assembled into lines, a partial line only reaches the buffer once its LF
+ * 				is written or vUBufDedupFlush() is called. Lines are compared by length and hash.
+ */
+int xUBufDedupStart(ubuf_t * psUB, u16_t msLimit);
+
+/**
+ * @brief		write any partial line and a pending repeat count to the buffer
+ * @note		call periodically (eg from the drain side) so that a run that ended is reported
+ */
+void vUBufDedupFlush(ubuf_t * psUB);
+
+/**
+ * @brief		flush then disable repeated line suppression
+ */
+void vUBufDedupStop(ubuf_t * psUB);
+
+/**
+ * @brief		enable/disable per task write combining
+ * @param[in]	psUB - pointer to buffer control structure
+ * @param[in]	bStaged - true to stage task level writes
+ * @note		Each writing task gathers fragments in its own ubuf_stage_t (TLS slot ubufSTAGE_TLS)
+ * 				and writes them to the buffer in one locked copy at LF, when the stage is full, on
+ * 				vUBufStageFlush(), or when that task next writes to another buffer. ISR writes and
+ * 				writes before the scheduler runs are never staged.
+ * @note		Staged bytes are not yet visible to readers. Disabling (also done by vUBufDestroy()
+ * 				and close()) writes out the stages of ALL tasks holding bytes for the buffer, waiting
+ * 				for any task busy with its stage. A task writing meanwhile re-checks the flag once it
+ * 				holds its stage and writes out its own bytes first, so per task order is kept.
+ * @note		When a task is deleted its stage is written out only if the buffer can be locked and
+ * 				has space right now, else discarded; flush before vTaskDelete().
+ */
+void vUBufSetStaged(ubuf_t * psUB, bool bStaged);
+
+/**
+ * @brief		write the calling task's staged bytes (if any) to their buffer
+ */
+void vUBufStageFlush(void);
+
+/**
+ * @brief		allow an idle ring to release its storage under memory pressure
+ * @param[in]	psUB - buffer with allocated storage (f_alloc), not history or lock free
+ * @param[in]	Caps - ballocCAP_??? used to reallocate, normally as passed to psUBufCreateCaps()
+ * @return		erSUCCESS or erFAILURE with errno set, ENOSPC if ubufRECLAIM_MAX rings registered
+ * @note		A released ring reads as empty and reallocates on the next write, which fails with
+ * 				errno = ENOMEM if the budget (see vBAllocSetBudget()) still cannot be met.
+ * @note		pcUBufTellWrite()/vUBufStepWrite() access outside the lock; the pointer returned is
+ * 				only valid until the ring is idle again. VFS opened rings cannot be registered.
+ */
+int xUBufSetReclaim(ubuf_t * psUB, u32_t Caps);
+
+/**
+ * @brief		release the storage of registered rings that are empty and idle
+ * @param[in]	msIdle - ring not locked (read, written or drained) for at least this period,
+ * 				measured between successive calls, 0 = any empty ring not locked right now
+ * @return		number of bytes released
+ * @note		call periodically with msIdle > 0, rings are only try-locked, never waited for
+ */
+size_t xUBufReclaim(u32_t msIdle);
+
+/**
+ * @brief		reclaim hook for vBAllocSetReclaim(), releases every empty ring not locked now
+ */
+size_t xUBufReclaimHook(size_t Need);
+
 /**
  * @brief		return the buffer read pointer
  * @param[in]	psUB - pointer to buffer control structure
@@ -120,6 +477,16 @@ ssize_t xUBufWrite(ubuf_t * psUB, const void * pBuf, size_t Size);
  */
 u8_t * pcUBufTellRead(ubuf_t * psUB);
 
+/**
+ * @brief		view of the contiguous unread data in RAM, nothing copied nor consumed
+ * @param[in]	psUB - pointer to buffer control structure
+ * @param[out]	pLen - number of bytes available at the pointer returned
+ * @return		pointer to next byte to be read, NULL with *pLen 0 and errno EBUSY if spilling (older
+ * 				data not in RAM), ENODATA if the idle storage was reclaimed or ENOMEM if there is none
+ * @note		valid until consumed, only the consumer may use it. Less than xUBufGetUsed() if wrapped
+ */
+u8_t * pcUBufPeek(ubuf_t * psUB, size_t * pLen);
+
 /**
  * @brief		return the buffer write pointer
  * @param[in]	psUB - pointer to buffer control structure
@@ -127,6 +494,26 @@ u8_t * pcUBufTellRead(ubuf_t * psUB);
  */
 u8_t * pcUBufTellWrite(ubuf_t * psUB);
 
+/**
+ * @brief		write up to Max bytes directly into the free segment(s) of the buffer
+ * @param[in]	psUB - pointer to buffer control structure
+ * @param[in]	fill - called, buffer locked, per contiguous free segment to copy up to Len bytes
+ * 				to pDst. Returns the number copied, less than Len ends the write
+ * @return		number of bytes written, erINV_PARA if no buffer or erFAILURE if reallocation failed
+ * @note		Only what fits now is written; staging, dedup and the overflow policy are bypassed
+ */
+ssize_t xUBufWriteFill(ubuf_t * psUB, size_t Max, size_t (*fill)(void * pvCtx, u8_t * pDst, size_t Len), void * pvCtx);
+
+/**
+ * @brief		move up to Max bytes from one buffer into another without intermediate copies
+ * @param[in]	psDst - destination, only the space free now is used
+ * @param[in]	psSrc - source, spilled data (if any) is read first, straight into the destination
+ * @param[in]	Max - maximum bytes to move, 0 = as much as possible
+ * @return		number of bytes moved (partial if space or data ran out) or erFAILURE with errno set
+ * @note		Both buffers are locked, in address order, at most 4 memcpy for RAM to RAM
+ */
+ssize_t xUBufSplice(ubuf_t * psDst, ubuf_t * psSrc, size_t Max);
+
 /**
  * @brief		step the buffer read pointer specified number of positions
  * @param[in]	psUB - pointer to buffer control structure
@@ -153,6 +540,25 @@ void vUBufStepWrite(ubuf_t * psUB, int Step);
  */
 ubuf_t * psUBufCreate(ubuf_t * psUB, u8_t * pcBuf, size_t BufSize, size_t Used);
 
+/**
+ * @brief		As for psUBufCreate() but buffer (if not supplied) allocated as specified
+ * @param[in]	psUB structure to initialise
+ * @param[in]	pcBuf preallocated buffer, if NULL will allocate using psA and Caps
+ * @param[in]	BufSize size of preallocated buffer, or size to be allocated
+ * @param[in]	Used If preallocated buffer, portion already used
+ * @param[in]	psA allocator to use, NULL for default
+ * @param[in]	Caps ballocCAP_??? flags plus optional ballocALIGN(x), buffer only cleared if ballocCAP_ZERO
+ * @return		pointer to the buffer structure or NULL if allocation failed
+ */
+ubuf_t * psUBufCreateCaps(ubuf_t * psUB, u8_t * pcBuf, size_t BufSize, size_t Used, const balloc_t * psA, u32_t Caps);
+
+/**
+ * @brief		set allocator and capabilities for buffers opened via the VFS (/ubuf)
+ * @param[in]	psA allocator to use, NULL for default
+ * @param[in]	Caps ballocCAP_??? flags plus optional ballocALIGN(x)
+ */
+void vUBufSetAllocator(const balloc_t * psA, u32_t Caps);
+
 /**
  * @brief		Delete semaphore and free allocated (buffer and/or structure) memory if allocated
  * @param[in]	psUB structure to destroy
@@ -197,6 +603,22 @@ int xUBufStringPrv(ubuf_t * psUB, u8_t * pu8Buf, int Size);
  */
 void vUBufStringAdd(ubuf_t * psUB, u8_t * pu8Buf, int Size);
 
+/**
+ * @brief		load a history buffer from its log file, creating it if absent or invalid, keep it open
+ * @param[in]	psUB - pointer to history (f_history) buffer, same Size as when logged
+ * @param[in]	psL - pointer to log control structure, see x_hlog.h
+ * @param[in]	pccPath - log file path, shorter than hlogPATHMAX - 1
+ * @return		erSUCCESS or erFAILURE with errno set
+ * @note		the log is compacted once twice the buffer size has been appended, close with vHLogClose()
+ */
+int xUBufHistOpen(ubuf_t * psUB, hlog_t * psL, const char * pccPath);
+
+/**
+ * @brief		add an entry as vUBufStringAdd() does and append it to the log
+ * @return		erSUCCESS or erFAILURE with errno set, history updated regardless
+ */
+int xUBufHistAdd(ubuf_t * psUB, hlog_t * psL, u8_t * pu8Buf, int Size);
+
 struct report_t;
 int vUBufReport(struct report_t * psR, ubuf_t *);
 
@@ -50,26 +50,33 @@ char * pcUUBufGetS(char * pBuf, int Number, uubuf_t * psUUBuf) {
 	return pBuf;										// and return a valid state
 }
 
-int	xUUBufCreate(uubuf_t * psUUBuf, char * pcBuf, size_t BufSize, size_t Used) {
+int	xUUBufCreateCaps(uubuf_t * psUUBuf, char * pcBuf, size_t BufSize, size_t Used, const balloc_t * psA, u32_t Caps) {
 	psUUBuf->Size = BufSize;
 	psUUBuf->Idx = 0;
+	psUUBuf->psA = psA;
 	if (pcBuf) {
 		psUUBuf->pBuf = pcBuf;
 		psUUBuf->Used = Used;
 		psUUBuf->Alloc = 0;								// show memory as provided, NOT allocated
 	} else {
-		psUUBuf->pBuf = malloc(psUUBuf->Size);
+		psUUBuf->pBuf = pvBAllocType(psA, ballocTYPE_UUBUF, psUUBuf->Size, Caps & ~ballocCAP_ZERO);
+		if (psUUBuf->pBuf == NULL)
+			return erFAILURE;
 		psUUBuf->Used = 0;
 		psUUBuf->Alloc = psUUBuf->Size;					// show memory as ALLOCATED
 	}
-	if (psUUBuf->Used == 0)
+	if ((psUUBuf->Used == 0) && (Caps & ballocCAP_ZERO))
 		memset(psUUBuf->pBuf, 0, psUUBuf->Size);		// clear buffer ONLY if nothing to be used
 	return psUUBuf->Size;
 }
 
+int	xUUBufCreate(uubuf_t * psUUBuf, char * pcBuf, size_t BufSize, size_t Used) {
+	return xUUBufCreateCaps(psUUBuf, pcBuf, BufSize, Used, NULL, ballocCAP_ZERO);
+}
+
 void vUUBufDestroy(uubuf_t * psUUBuf) {
 	if (psUUBuf->Alloc)
-		free(psUUBuf->pBuf);
+		vBFreeType(psUUBuf->psA, ballocTYPE_UUBUF, psUUBuf->pBuf, psUUBuf->Alloc);
 }
 
 void vUUBufAdjust(uubuf_t * psUUBuf, ssize_t Adj) {
@@ -81,7 +88,94 @@ void vUUBufAdjust(uubuf_t * psUUBuf, ssize_t Adj) {
 	psUUBuf->Used += Adj;
 }
 
+/**
+ * @brief		space available for writing at the cursor
+ */
+static size_t xUUBufRoom(uubuf_t * psUUBuf) {
+	size_t Room = psUUBuf->Size - psUUBuf->Idx;
+	return (Room < xUUBufSpace(psUUBuf)) ? Room : xUUBufSpace(psUUBuf);
+}
+
+size_t xUUBufWrite(uubuf_t * psUUBuf, const void * pvBuf, size_t Size) {
+	if (Size > xUUBufRoom(psUUBuf))
+		Size = xUUBufRoom(psUUBuf);
+	memcpy(psUUBuf->pBuf + psUUBuf->Idx, pvBuf, Size);
+	psUUBuf->Idx += Size;
+	psUUBuf->Used += Size;
+	return Size;
+}
+
+size_t xUUBufRead(uubuf_t * psUUBuf, void * pvBuf, size_t Size) {
+	if (Size > psUUBuf->Used)
+		Size = psUUBuf->Used;
+	memcpy(pvBuf, psUUBuf->pBuf + psUUBuf->Idx, Size);
+	psUUBuf->Idx += Size;
+	psUUBuf->Used -= Size;
+	return Size;
+}
+
+char * pcUUBufPeek(uubuf_t * psUUBuf, size_t * pLen) {
+	*pLen = psUUBuf->Used;
+	return psUUBuf->pBuf + psUUBuf->Idx;
+}
+
+ssize_t xUUBufFind(uubuf_t * psUUBuf, const void * pvDelim, size_t Len) {
+	if ((Len == 0) || (Len > psUUBuf->Used))
+		return erFAILURE;
+	const char * pcBeg = psUUBuf->pBuf + psUUBuf->Idx;
+	const char * pcNow = pcBeg;
+	const char * pcLast = pcBeg + psUUBuf->Used - Len;	// last position a match can start
+	const u8_t u8First = *(const u8_t *) pvDelim;
+	while (pcNow <= pcLast) {
+		pcNow = memchr(pcNow, u8First, pcLast - pcNow + 1);
+		if (pcNow == NULL)
+			break;
+		if ((Len == 1) || (memcmp(pcNow + 1, (const u8_t *) pvDelim + 1, Len - 1) == 0))
+			return pcNow - pcBeg;
+		++pcNow;
+	}
+	return erFAILURE;
+}
+
+size_t xUUBufConsume(uubuf_t * psUUBuf, size_t Size) {
+	if (Size > psUUBuf->Used)
+		Size = psUUBuf->Used;
+	psUUBuf->Idx += Size;
+	psUUBuf->Used -= Size;
+	return Size;
+}
+
+size_t xUUBufAdvance(uubuf_t * psUUBuf, size_t Size) {
+	if (Size > xUUBufRoom(psUUBuf))
+		Size = xUUBufRoom(psUUBuf);
+	psUUBuf->Idx += Size;
+	psUUBuf->Used += Size;
+	return Size;
+}
+
 int vUUBufReport(report_t * psR, uubuf_t * psUUBuf) {
 	return PX("P=%p  B=%p  I=%d  S=%d  U=%d  A=%d\r\n%!'+hhY%s", psUUBuf, psUUBuf->pBuf, psUUBuf->Idx, 
 			psUUBuf->Size, psUUBuf->Used, psUUBuf->Alloc, psUUBuf->Used, psUUBuf->pBuf, fmTST(aNL) ? strNLx2 : strNL);
 }
+
+// ################################## Diagnostic and testing functions #############################
+
+void vUUBufTest(void) {
+	uubuf_t sUU;
+	char caBuf[24], caOut[24];
+	// building: bulk write clamped to space, in place write committed
+	xUUBufCreate(&sUU, caBuf, sizeof(caBuf), 0);
+	if (xUUBufWrite(&sUU, "key=val\r\n", 9) != 9)								PX("Failed write" strNL);
+	memcpy(pcUUBufPos(&sUU), "x=1\r\n", 5);
+	if (xUUBufAdvance(&sUU, 5) != 5)											PX("Failed advance" strNL);
+	if (xUUBufWrite(&sUU, "0123456789abcdef", 16) != 10)						PX("Failed clamp" strNL);
+	// parsing: find, view and consume in place, then bulk read
+	xUUBufCreate(&sUU, caBuf, sizeof(caBuf), 14);
+	size_t Len;
+	char * pcNow = pcUUBufPeek(&sUU, &Len);
+	ssize_t Off = xUUBufFind(&sUU, "\r\n", 2);
+	if ((pcNow != caBuf) || (Len != 14) || (Off != 7))							PX("Failed peek/find" strNL);
+	if ((xUUBufConsume(&sUU, Off + 2) != 9) || (xUUBufFind(&sUU, "=", 1) != 1))	PX("Failed consume" strNL);
+	if ((xUUBufRead(&sUU, caOut, sizeof(caOut)) != 5) || memcmp(caOut, "x=1\r\n", 5))	PX("Failed read" strNL);
+	if ((xUUBufFind(&sUU, "\n", 1) != erFAILURE) || (xUUBufConsume(&sUU, 1) != 0))	PX("Failed empty" strNL);
+}
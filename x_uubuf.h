@@ -8,6 +8,7 @@
 #include <sys/types.h>
 
 #include "definitions.h"
+#include "x_balloc.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,9 +19,20 @@ extern "C" {
 
 // ###################################### BUILD : CONFIG definitions ###############################
 
+#ifndef configBUFFERS_WIDE_INDEX
+	#define	configBUFFERS_WIDE_INDEX	0			// 1 = 32bit indexes, multi-MB (PSRAM) buffers
+#endif
+
 #define	pbufSIZE_MINIMUM			128
 #define	pbufSIZE_DEFAULT			1024
-#define	pbufSIZE_MAXIMUM			32768
+
+#if (configBUFFERS_WIDE_INDEX > 0)
+	typedef u32_t uubidx_t;
+	#define	pbufSIZE_MAXIMUM		(32 * 1024 * 1024)
+#else
+	typedef u16_t uubidx_t;
+	#define	pbufSIZE_MAXIMUM		32768
+#endif
 
 // ####################################### enumerations ############################################
 
@@ -29,10 +41,11 @@ extern "C" {
 
 typedef	struct __attribute__((packed)) uubuf_t {
 	char * pBuf;
-	u16_t Idx;
-	u16_t Size;
-	u16_t Used;
-	u16_t Alloc;
+	uubidx_t Idx;
+	uubidx_t Size;
+	uubidx_t Used;
+	uubidx_t Alloc;
+	const balloc_t * psA;			// allocator used for pBuf, if Alloc non-zero
 } uubuf_t;
 
 // ################################### EXTERNAL FUNCTIONS ##########################################
@@ -41,12 +54,54 @@ inline size_t xUUBufSpace(uubuf_t * psUUBuf) { return psUUBuf->Size - psUUBuf->U
 inline size_t xUUBufAvail(uubuf_t * psUUBuf) { return psUUBuf->Used; }
 inline char * pcUUBufPos(uubuf_t * psUUBuf) { return psUUBuf->pBuf + psUUBuf->Idx; }
 
+/* Single cursor buffer: Idx is the WRITE position while building (xUUBufPutC/xUUBufWrite/xUUBufAdvance)
+ * and the READ position while parsing (xUUBufGetC/xUUBufRead/xUUBufPeek/xUUBufConsume), in which
+ * case the Used bytes at Idx are the unread data. No locking, caller serialises access. */
+
 int	xUUBufPutC(uubuf_t * psUUBuf, int cChr);
 int	xUUBufGetC(uubuf_t * psUUBuf);
 char * pcUUBufGetS(char * pBuf, int Number, uubuf_t * psUUBuf);
 int	xUUBufCreate(uubuf_t * psUUBuf, char * pBuf, size_t BufSize, size_t Used);
+int	xUUBufCreateCaps(uubuf_t * psUUBuf, char * pBuf, size_t BufSize, size_t Used, const balloc_t * psA, u32_t Caps);
 void vUUBufDestroy(uubuf_t * psUUBuf);
 void vUUBufAdjust(uubuf_t * psUUBuf, ssize_t Adj);
+
+/**
+ * @brief		write multiple bytes at the cursor with a single copy
+ * @return		number of bytes written, possibly less than requested if insufficient space
+ */
+size_t xUUBufWrite(uubuf_t * psUUBuf, const void * pvBuf, size_t Size);
+
+/**
+ * @brief		read (and consume) multiple bytes at the cursor with a single copy
+ * @return		number of bytes read, possibly less than requested
+ */
+size_t xUUBufRead(uubuf_t * psUUBuf, void * pvBuf, size_t Size);
+
+/**
+ * @brief		view of the unread data, nothing copied nor consumed
+ * @param[out]	pLen - number of bytes available at the pointer returned
+ * @return		pointer to the next byte to be read
+ */
+char * pcUUBufPeek(uubuf_t * psUUBuf, size_t * pLen);
+
+/**
+ * @brief		find delimiter (1 or more bytes) in the unread data
+ * @return		offset of the delimiter from the read position, or erFAILURE if not present
+ */
+ssize_t xUUBufFind(uubuf_t * psUUBuf, const void * pvDelim, size_t Len);
+
+/**
+ * @brief		consume bytes processed in place (after xUUBufPeek/xUUBufFind)
+ * @return		number of bytes actually consumed, limited to bytes available
+ */
+size_t xUUBufConsume(uubuf_t * psUUBuf, size_t Size);
+
+/**
+ * @brief		commit bytes written in place at pcUUBufPos()
+ * @return		number of bytes actually committed, limited to space available
+ */
+size_t xUUBufAdvance(uubuf_t * psUUBuf, size_t Size);
 struct report_t;
 int vUUBufReport(struct report_t *, uubuf_t * psUUBuf);
 